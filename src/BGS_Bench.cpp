@@ -0,0 +1,201 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "IMBSBuilder.h"
+#include "T2FGMM_UMBuilder.h"
+#include "T2FMRF_UMBuilder.h"
+#include "SceneGenerator.h"
+
+using namespace cv;
+using namespace std;
+
+const char* keys =
+{
+    "{ a | algorithm  | all     | imbs, t2fgmm_um, t2fmrf_um or all }"
+    "{ s | size       | 640x480 | Frame size }"
+    "{ n | frames     | 300     | Frames measured }"
+    "{ w | warmup     | 50      | Frames given to the model before measuring }"
+    "{ g | foreground | 0.1     | Fraction of the frame covered by moving objects }"
+    "{ z | noise      | 4       | Standard deviation of the pixel noise }"
+    "{ d | seed       | 1       | Seed of the generated frames }"
+    "{ k | interval   | 1       | ModelUpdateInterval values, comma separated, e.g. 1,2,4,8 }"
+    "{ h | help       | false   | Print help message }"
+};
+
+void display_message()
+{
+    cout << "Update benchmark of the background subtraction builders.    " << endl;
+    cout << "------------------------------------------------------------" << endl;
+    cout << "Runs each builder with its default parameters on a generated" << endl;
+    cout << "scene and reports the latency of Update() per frame.        " << endl;
+    cout << "Example:                                                    " << endl;
+    cout << "bgs_bench -a all -s 1280x720 -g 0.2 -z 6                    " << endl;
+    cout << "bgs_bench -a t2fgmm_um -k 1,2,4,8                           " << endl << endl;
+    cout << "------------------------------------------------------------" << endl <<endl;
+}
+
+
+template <class Builder>
+static IBGSAlgorithm* configure(Builder* builder, int interval)
+{
+    builder->SetModelUpdateInterval(interval);
+    builder->Initialization();
+
+    return builder;
+}
+
+// Builder with its default parameters and the given ModelUpdateInterval,
+// the config files are not read
+static IBGSAlgorithm* create_builder(const string& algorithm, Size size, int interval)
+{
+    if (algorithm == "imbs")
+        return configure(new IMBSBuilder(size, CV_8UC3), interval);
+    if (algorithm == "t2fgmm_um")
+        return configure(new T2FGMM_UMBuilder(size.width, size.height, 3), interval);
+    if (algorithm == "t2fmrf_um")
+        return configure(new T2FMRF_UMBuilder(size.width, size.height, 3), interval);
+
+    return NULL;
+}
+
+// Percentile of sorted latencies
+static double percentile(const vector<double>& sorted, double p)
+{
+    size_t k = (size_t)std::ceil(p*sorted.size());
+    return sorted[std::min(std::max(k, (size_t)1), sorted.size()) - 1];
+}
+
+
+int main( int argc, char** argv )
+{
+    //Parse console parameters
+    CommandLineParser cmd(argc, argv, keys);
+
+    const string algorithm  = cmd.get<string>("algorithm");
+    const string frameSize  = cmd.get<string>("size");
+    const int    maxFrames  = cmd.get<int>("frames");
+    const int    warmup     = cmd.get<int>("warmup");
+    const double foreground = cmd.get<double>("foreground");
+    const double noise      = cmd.get<double>("noise");
+    const int    seed       = cmd.get<int>("seed");
+    const string intervalList = cmd.get<string>("interval");
+
+    if (cmd.get<bool>("help")) {
+        display_message();
+        cmd.printParams();
+        return 0;
+    }
+
+    Size size;
+    if (sscanf(frameSize.c_str(), "%dx%d", &size.width, &size.height) != 2 ||
+        size.width <= 0 || size.height <= 0 || maxFrames <= 0) {
+        cout << "Invalid frame size or number of frames" << endl;
+        return 0;
+    }
+
+    vector<string> algorithms;
+    if (algorithm == "all") {
+        algorithms.push_back("imbs");
+        algorithms.push_back("t2fgmm_um");
+        algorithms.push_back("t2fmrf_um");
+    }
+    else {
+        algorithms.push_back(algorithm);
+    }
+
+    vector<int> intervals;
+    stringstream list(intervalList);
+    for (string item; std::getline(list, item, ',');) {
+        int k = atoi(item.c_str());
+        if (k <= 0) {
+            cout << "Invalid interval " << item << endl;
+            return 0;
+        }
+        intervals.push_back(k);
+    }
+    if (intervals.empty())
+        intervals.push_back(1);
+
+    SceneParams params;
+    params.size       = size;
+    params.seed       = seed;
+    params.foreground = foreground;
+    params.noise      = noise;
+
+    cout << "# frames=" << maxFrames << " warmup=" << warmup
+         << " size=" << size.width << "x" << size.height
+         << " foreground=" << foreground << " noise=" << noise << " seed=" << seed << endl;
+    cout << "# algorithm     k    mean ms     p50 ms     p99 ms   frames/s    Mpixels/s" << endl;
+
+    for (size_t run = 0; run < algorithms.size()*intervals.size(); ++run) {
+
+        size_t a = run / intervals.size();
+        int interval = intervals[run % intervals.size()];
+
+        IBGSAlgorithm* builder = create_builder(algorithms[a], size, interval);
+        if (builder == NULL) {
+            cout << "Unknown algorithm " << algorithms[a] << endl;
+            continue;
+        }
+
+        // every algorithm sees the same frames
+        SceneGenerator scene(params);
+        Mat frame, truth, mask;
+        vector<double> latency;
+
+        for (int cnt = 0; cnt < warmup + maxFrames; ++cnt) {
+            scene.Render(cnt, frame, truth);
+
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            builder->Update(frame, mask);
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            if (cnt >= warmup)
+                latency.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+        }
+
+        delete builder;
+
+        double total = 0.;
+        for (size_t k = 0; k < latency.size(); ++k)
+            total += latency[k];
+        double mean = total/latency.size();
+        std::sort(latency.begin(), latency.end());
+
+        cout << left  << setw(12) << algorithms[a]
+             << right << setw(5) << interval
+             << fixed << setprecision(3)
+             << setw(11) << mean
+             << setw(11) << percentile(latency, 0.50)
+             << setw(11) << percentile(latency, 0.99)
+             << setw(11) << setprecision(1) << 1000./mean
+             << setw(13) << setprecision(2) << size.area()/(mean*1000.)
+             << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+#include "ChromeTrace.h"
+
+
+// Events are kept in chunks, a full chunk is never moved
+static const size_t TRACE_CHUNK = 4096;
+
+struct TraceEvent
+{
+    int64_t begin;          // nanoseconds since Enable()
+    int64_t duration;
+    int32_t name;
+    int32_t category;
+    int32_t frame;
+    int32_t tile;
+};
+
+struct TraceLane
+{
+    TraceLane(int id) : id(id), used(TRACE_CHUNK) {}
+
+    void Add(const TraceEvent& event)
+    {
+        if (used == TRACE_CHUNK) {
+            chunks.push_back(new TraceEvent[TRACE_CHUNK]);
+            used = 0;
+        }
+        chunks.back()[used++] = event;
+    }
+
+    size_t Size(size_t chunk) const
+    {
+        return chunk + 1 == chunks.size() ? used : TRACE_CHUNK;
+    }
+
+    int id;
+    std::vector<TraceEvent*> chunks;
+    size_t used;            // events in the last chunk
+};
+
+
+std::atomic<bool> ChromeTrace::enabled(false);
+
+static std::mutex lanes_mtx;
+static std::vector<TraceLane*> lanes;       // by id
+static std::vector<TraceLane*> free_lanes;  // of threads that ended
+
+static std::mutex names_mtx;
+static std::deque<string> names;
+
+static string trace_file;
+static ChromeTrace::Clock::time_point origin;
+
+
+static TraceLane* acquire_lane()
+{
+    std::lock_guard<std::mutex> lock(lanes_mtx);
+
+    if (!free_lanes.empty()) {
+        TraceLane* lane = free_lanes.back();
+        free_lanes.pop_back();
+        return lane;
+    }
+
+    lanes.push_back(new TraceLane((int)lanes.size()));
+    return lanes.back();
+}
+
+// Lane of the calling thread, given back when the thread ends
+struct LaneHolder
+{
+    LaneHolder() : lane(NULL) {}
+
+    ~LaneHolder()
+    {
+        if (lane != NULL) {
+            std::lock_guard<std::mutex> lock(lanes_mtx);
+            free_lanes.push_back(lane);
+        }
+    }
+
+    TraceLane* lane;
+};
+
+static thread_local LaneHolder holder;
+
+
+void ChromeTrace::Enable(const string& filename)
+{
+    if (Enabled())
+        return;
+
+    trace_file = filename;
+    origin     = Clock::now();
+
+    if (holder.lane == NULL)
+        holder.lane = acquire_lane();
+
+    enabled.store(true);
+}
+
+int ChromeTrace::Name(const string& name)
+{
+    std::lock_guard<std::mutex> lock(names_mtx);
+
+    for (size_t k = 0; k < names.size(); ++k)
+        if (names[k] == name)
+            return (int)k;
+
+    names.push_back(name);
+    return (int)names.size() - 1;
+}
+
+void ChromeTrace::Record(int name, int category, Clock::time_point begin,
+                         Clock::time_point end, int frame, int tile)
+{
+    if (holder.lane == NULL)
+        holder.lane = acquire_lane();
+
+    TraceEvent event;
+    event.begin    = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin).count();
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    event.name     = name;
+    event.category = category;
+    event.frame    = frame;
+    event.tile     = tile;
+
+    holder.lane->Add(event);
+}
+
+// Names are ours, quotes and backslashes are escaped all the same
+static string json_string(const string& text)
+{
+    string str;
+    for (size_t k = 0; k < text.size(); ++k) {
+        if (text[k] == '"' || text[k] == '\\')
+            str += '\\';
+        str += text[k];
+    }
+
+    return str;
+}
+
+bool ChromeTrace::Write()
+{
+    if (!Enabled())
+        return false;
+
+    FILE* out = fopen(trace_file.c_str(), "w");
+    if (out == NULL)
+        return false;
+
+    std::lock_guard<std::mutex> lock(lanes_mtx);
+    std::vector<string> text;
+    {
+        std::lock_guard<std::mutex> names_lock(names_mtx);
+        for (size_t k = 0; k < names.size(); ++k)
+            text.push_back(json_string(names[k]));
+    }
+
+    fprintf(out, "{\"traceEvents\":[\n");
+
+    // lane 0 is the thread that called Enable()
+    bool first = true;
+    for (size_t l = 0; l < lanes.size(); ++l) {
+        fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                     "\"args\":{\"name\":\"",
+                first ? "" : ",\n", lanes[l]->id);
+        if (l == 0)
+            fprintf(out, "main\"}}");
+        else
+            fprintf(out, "worker %d\"}}", lanes[l]->id);
+        first = false;
+    }
+
+    for (size_t l = 0; l < lanes.size(); ++l) {
+        const TraceLane* lane = lanes[l];
+        for (size_t c = 0; c < lane->chunks.size(); ++c) {
+            for (size_t k = 0; k < lane->Size(c); ++k) {
+                const TraceEvent& e = lane->chunks[c][k];
+
+                fprintf(out, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                             "\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                        first ? "" : ",\n", text[e.name].c_str(), text[e.category].c_str(),
+                        lane->id, 1e-3*e.begin, 1e-3*e.duration);
+                if (e.frame >= 0)
+                    fprintf(out, "\"frame\":%d%s", e.frame, e.tile >= 0 ? "," : "");
+                if (e.tile >= 0)
+                    fprintf(out, "\"tile\":%d", e.tile);
+                fprintf(out, "}}");
+
+                first = false;
+            }
+        }
+    }
+
+    fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+    return fclose(out) == 0;
+}
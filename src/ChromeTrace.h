@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _CHROME_TRACE_H
+#define _CHROME_TRACE_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <chrono>
+
+using std::string;
+
+
+/*
+ * Timeline of a run in the Chrome trace event format, opened with
+ * Perfetto (ui.perfetto.dev) or chrome://tracing. Each event is a span
+ * with a begin time and a duration ("ph":"X"), with the frame and tile
+ * it belongs to as arguments.
+ *
+ * Every thread records into its own buffer without locks. The buffer of
+ * a thread that ends goes back to a pool for the next thread, so threads
+ * spawned per frame reuse a few buffers, and each buffer is a lane
+ * ("tid") of the timeline. Write() is called once the recording threads
+ * are done, normally at exit.
+ *
+ * Nothing is recorded until Enable(), and Span() only checks a flag then.
+ */
+class ChromeTrace
+{
+
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Start recording, Write() saves to filename. The calling thread is
+    // the "main" lane.
+    static void Enable(const string& filename);
+    static bool Enabled() { return enabled.load(std::memory_order_relaxed); };
+
+    // Id of a name or category, the same string gives the same id
+    static int Name(const string& name);
+
+    // Span of the calling thread, frame and tile are left out when < 0
+    static void Span(int name, int category, Clock::time_point begin,
+                     Clock::time_point end, int frame = -1, int tile = -1)
+    {
+        if (Enabled())
+            Record(name, category, begin, end, frame, tile);
+    };
+
+    // Writes the events of all the lanes, false when nothing was enabled
+    // or the file could not be written
+    static bool Write();
+
+private:
+
+    static void Record(int name, int category, Clock::time_point begin,
+                       Clock::time_point end, int frame, int tile);
+
+    static std::atomic<bool> enabled;
+
+};
+
+
+#endif
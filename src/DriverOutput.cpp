@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <limits.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "DriverOutput.h"
+#include "utils.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+
+DriverOutput::DriverOutput(const string& _name)
+    : name(_name), maskPath(_name + "_mask"), saveMasks(false),
+      first(0), last(INT_MAX)
+{
+}
+
+DriverOutput::~DriverOutput()
+{
+    Close();
+}
+
+void DriverOutput::OpenStream(const string& path, const string& encoding)
+{
+    if (path.empty())
+        return;
+
+    uint32_t code;
+    if (path == "stdout")
+        cout.rdbuf(cerr.rdbuf());
+    if (!mask_stream_encoding_from_name(encoding, code) ||
+        !stream.Open(path, code))
+        cout << "Could not open mask stream " << path << endl;
+}
+
+void DriverOutput::SetRange(int _first, int _last)
+{
+    first = _first;
+    last  = _last;
+}
+
+void DriverOutput::OpenMasks(const string& parameters, Size size,
+                             bool archiveOutput, uint32_t encoding, int keyframes)
+{
+    // Create foreground directory and numbered sub-directories (alg_mask/0, alg_mask/1, ...)
+    create_foreground_directory(maskPath);
+    saveMasks = true;
+
+    std::ofstream outfile((maskPath + "/parameters.txt").c_str());
+    outfile << parameters;
+    outfile.close();
+
+    if (archiveOutput &&
+        !archive.Open(maskPath + "/masks.bgsm", size.width, size.height,
+                      encoding, keyframes))
+        cout << "Could not create mask archive, saving png files" << endl;
+}
+
+void DriverOutput::OpenGroundTruth(const string& dir)
+{
+    // Score the masks while they are computed instead of reading them back
+    if (!dir.empty() && !evaluator.Open(dir, first, last))
+        cout << "No ground-truth images in " << dir << endl;
+}
+
+void DriverOutput::SetPins(const string& points, Size size)
+{
+    pins.clear();
+    if (points.empty())
+        return;
+
+    if (!PixelTraceRecorder::ParsePoints(points, pins)) {
+        cout << "Invalid point list " << points << endl;
+        pins.clear();
+    }
+
+    for (size_t k = 0; k < pins.size(); ++k) {
+        pins[k].x = std::min(std::max(pins[k].x, 0), size.width - 1);
+        pins[k].y = std::min(std::max(pins[k].y, 0), size.height - 1);
+    }
+}
+
+void DriverOutput::WriteMask(int frame, const Mat& mask)
+{
+    if (!saveMasks || frame < first || frame > last)
+        return;
+
+    if (archive.IsOpen()) {
+        if (archive.Write(frame, mask))
+            return;
+        cout << "Could not write mask archive, saving png files" << endl;
+    }
+
+    std::stringstream str;
+    std::vector<int> compression_params;
+    compression_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    compression_params.push_back(9);
+
+    try {
+        str << maskPath << "/" << frame << ".png";
+        imwrite(str.str(), mask, compression_params);
+    }
+    catch (std::runtime_error& ex) {
+        cout << "Exception converting image to PNG format: " << ex.what() << endl;
+    }
+    catch (...) {
+        cout << "Unknown Exception converting image to PNG format: " << endl;
+    }
+}
+
+void DriverOutput::StreamMask(int frame, const Mat& mask)
+{
+    if (stream.IsOpen() && !stream.Write(frame, mask))
+        cout << "Mask stream closed by the reader" << endl;
+}
+
+void DriverOutput::ScoreMask(int frame, const Mat& mask)
+{
+    if (evaluator.IsOpen())
+        evaluator.Evaluate(frame, mask);
+}
+
+void DriverOutput::Summary(const string& parameters)
+{
+    // Scores with the parameters that produced them
+    if (!evaluator.IsOpen())
+        return;
+
+    FrameScore total = evaluator.Total();
+    cout << "Scored " << total.frame << " frames: "
+         << "precision " << total.Precision() << " "
+         << "recall "    << total.Recall()    << " "
+         << "fmeasure "  << total.FMeasure()  << endl;
+    evaluator.WriteSummary(name + "_scores.txt", parameters);
+    evaluator.Close();
+}
+
+void DriverOutput::Close()
+{
+    if (!trace.Close())
+        cout << "Could not write pixel trace" << endl;
+    if (!archive.Close())
+        cout << "Could not write the index of the mask archive" << endl;
+    stream.Close();
+}
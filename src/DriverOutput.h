@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _DRIVER_OUTPUT_H
+#define _DRIVER_OUTPUT_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "MaskArchive.h"
+#include "MaskStream.h"
+#include "PixelTrace.h"
+#include "GroundTruthEvaluator.h"
+
+using namespace cv;
+using std::string;
+
+
+/*
+ * Where the masks of bgs_imbs, t2fgmm and t2fmrf go: the <name>_mask
+ * directory (an archive, or png files when there is none or it fails),
+ * the mask stream, the in-process scores and the pixel trace. Problems
+ * are reported on cout and the driver goes on without that output.
+ */
+class DriverOutput
+{
+
+public:
+
+    // name: lower case algorithm name, prefix of the files written
+    DriverOutput(const string& name);
+    ~DriverOutput();
+
+    // Masks to stdout or a named pipe. Messages go to stderr when the masks
+    // take stdout, so call it before anything else is printed.
+    void OpenStream(const string& path, const string& encoding);
+    // Frames whose masks are saved and scored, all of them by default
+    void SetRange(int first, int last);
+    // <name>_mask directory with parameters.txt, and the masks.bgsm
+    // archive of frames of the given size unless archive is false
+    void OpenMasks(const string& parameters, Size size,
+                   bool archive, uint32_t encoding, int keyframes);
+    // Score the range against the ground-truth images of dir
+    void OpenGroundTruth(const string& dir);
+    // Points of -p, clamped into frames of the given size
+    void SetPins(const string& points, Size size);
+
+    // Steps of a frame, each does nothing when its output is off
+    void WriteMask(int frame, const Mat& mask);
+    void StreamMask(int frame, const Mat& mask);
+    void ScoreMask(int frame, const Mat& mask);
+    // Pins with the model state of their pixel. The model has the
+    // PixelStateSize(), PixelStateLayout() and PixelState(Point, float*)
+    // of the builders, the size is known once it has seen a frame.
+    template <class Model>
+    void TracePixels(int frame, const Mat& image, const Mat& mask, Model& model);
+
+    const std::vector<Point>& Pins() const { return pins; };
+
+    // Totals of the scores on cout, per frame scores in <name>_scores.txt
+    void Summary(const string& parameters);
+    void Close();
+
+private:
+
+    string name;
+    string maskPath;
+    bool   saveMasks;
+    int    first;
+    int    last;
+
+    MaskArchiveWriter    archive;
+    MaskStream           stream;
+    GroundTruthEvaluator evaluator;
+    PixelTraceRecorder   trace;
+    std::vector<Point>   pins;
+    std::vector<float>   pixelState;
+
+};
+
+
+template <class Model>
+void DriverOutput::TracePixels(int frame, const Mat& image, const Mat& mask, Model& model)
+{
+    if (pins.empty())
+        return;
+
+    if (!trace.IsOpen()) {
+        pixelState.assign(std::max(model.PixelStateSize(), 1), 0.f);
+        if (!trace.Open(name + "_points.trace", pins,
+                        model.PixelStateSize(), model.PixelStateLayout())) {
+            std::cout << "Could not create pixel trace" << std::endl;
+            pins.clear();
+            return;
+        }
+    }
+
+    for (size_t k = 0; k < pins.size(); ++k) {
+        model.PixelState(pins[k], &pixelState[0]);
+        if (!trace.Add(frame, k, image.at<Vec3b>(pins[k]),
+                       mask.at<uchar>(pins[k]), &pixelState[0])) {
+            std::cout << "Could not write pixel trace" << std::endl;
+            pins.clear();
+        }
+    }
+}
+
+
+#endif
@@ -0,0 +1,471 @@
+/*
+This file is part of BGSLibrary.
+
+BGSLibrary is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BGSLibrary is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include "GraphCut.h"
+
+using namespace Algorithms::BackgroundSubtraction;
+
+GridGraphCut::GridGraphCut()
+{
+  width = height = stride = 0;
+  offset[0] = offset[1] = offset[2] = offset[3] = 0;
+  flow = 0;
+  time = 0;
+  queue_first = queue_last = NO_PARENT;
+}
+
+void GridGraphCut::Reset(int _width, int _height)
+{
+  if(_width != width || _height != height)
+  {
+    width = _width;
+    height = _height;
+    stride = width + 2;
+
+    int size = (height + 2)*stride;
+    cap.assign(4*size, 0.f);
+    terminal.assign(size, 0.f);
+    parent.resize(size);
+    sink.resize(size);
+    ts.resize(size);
+    dist.resize(size);
+    next.resize(size);
+    orphans.reserve(size);
+
+    offset[0] = -stride;
+    offset[1] = stride;
+    offset[2] = -1;
+    offset[3] = 1;
+  }
+
+  std::fill(parent.begin(), parent.end(), (int)NO_PARENT);
+  std::fill(next.begin(), next.end(), (int)NO_PARENT);
+  std::fill(sink.begin(), sink.end(), 0);
+  std::fill(ts.begin(), ts.end(), 0);
+  std::fill(dist.begin(), dist.end(), 0);
+
+  flow = 0;
+  time = 0;
+  queue_first = queue_last = NO_PARENT;
+  orphans.clear();
+}
+
+void GridGraphCut::SetUnary(int i, int j, double cost0, double cost1)
+{
+  // label 0 cuts the arc to the sink, label 1 the arc from the source;
+  // only the difference needs an arc, the common part goes to the flow
+  terminal[Node(i,j)] = (float)(cost1 - cost0);
+  flow += std::min(cost0, cost1);
+}
+
+void GridGraphCut::SetPairwise(double cost)
+{
+  float c = (float)cost;
+
+  for(int i = 0; i < height; ++i)
+  {
+    float *arcs = &cap[4*Node(i,0)];
+    for(int j = 0; j < width; ++j, arcs += 4)
+    {
+      arcs[0] = (i > 0) ? c : 0.f;
+      arcs[1] = (i < height - 1) ? c : 0.f;
+      arcs[2] = (j > 0) ? c : 0.f;
+      arcs[3] = (j < width - 1) ? c : 0.f;
+    }
+  }
+}
+
+void GridGraphCut::SetActive(int p)
+{
+  if(next[p] != NO_PARENT)
+    return;
+
+  if(queue_last != NO_PARENT)
+    next[queue_last] = p;
+  else
+    queue_first = p;
+
+  queue_last = p;
+  next[p] = p;
+}
+
+int GridGraphCut::NextActive()
+{
+  while(queue_first != NO_PARENT)
+  {
+    int p = queue_first;
+    queue_first = (next[p] == p) ? NO_PARENT : next[p];
+    if(queue_first == NO_PARENT)
+      queue_last = NO_PARENT;
+    next[p] = NO_PARENT;
+
+    // nodes that became free after being queued are skipped
+    if(parent[p] != NO_PARENT)
+      return p;
+  }
+
+  return NO_PARENT;
+}
+
+double GridGraphCut::MaxFlow()
+{
+  for(int i = 0; i < height; ++i)
+  {
+    for(int j = 0; j < width; ++j)
+    {
+      int p = Node(i,j);
+      if(terminal[p] != 0)
+      {
+        sink[p] = terminal[p] < 0;
+        parent[p] = TERMINAL;
+        ts[p] = 0;
+        dist[p] = 1;
+        SetActive(p);
+      }
+    }
+  }
+
+  int current = NO_PARENT;
+
+  for(;;)
+  {
+    int p = current;
+    if(p != NO_PARENT)
+    {
+      next[p] = NO_PARENT;
+      if(parent[p] == NO_PARENT)
+        p = NO_PARENT;
+    }
+    if(p == NO_PARENT && (p = NextActive()) == NO_PARENT)
+      break;
+
+    // grow the tree of p until it touches the other tree
+    int from = NO_PARENT, arc = 0;
+
+    if(!sink[p])
+    {
+      for(int a = 0; a < 4; ++a)
+      {
+        if(cap[4*p + a] <= 0)
+          continue;
+
+        int q = Head(p, a);
+        if(parent[q] == NO_PARENT)
+        {
+          sink[q] = 0;
+          parent[q] = a^1;
+          ts[q] = ts[p];
+          dist[q] = dist[p] + 1;
+          SetActive(q);
+        }
+        else if(sink[q])
+        {
+          from = p;
+          arc = a;
+          break;
+        }
+        else if(ts[q] <= ts[p] && dist[q] > dist[p])
+        {
+          parent[q] = a^1;
+          ts[q] = ts[p];
+          dist[q] = dist[p] + 1;
+        }
+      }
+    }
+    else
+    {
+      for(int a = 0; a < 4; ++a)
+      {
+        int q = Head(p, a);
+        if(cap[4*q + (a^1)] <= 0)
+          continue;
+
+        if(parent[q] == NO_PARENT)
+        {
+          sink[q] = 1;
+          parent[q] = a^1;
+          ts[q] = ts[p];
+          dist[q] = dist[p] + 1;
+          SetActive(q);
+        }
+        else if(!sink[q])
+        {
+          from = q;
+          arc = a^1;
+          break;
+        }
+        else if(ts[q] <= ts[p] && dist[q] > dist[p])
+        {
+          parent[q] = a^1;
+          ts[q] = ts[p];
+          dist[q] = dist[p] + 1;
+        }
+      }
+    }
+
+    ++time;
+
+    if(from == NO_PARENT)
+    {
+      current = NO_PARENT;
+      continue;
+    }
+
+    // keep p as the current node, it may have more paths to offer
+    next[p] = p;
+    current = p;
+
+    Augment(from, arc);
+
+    // rebuild the trees around the saturated arcs
+    for(size_t n = 0; n < orphans.size(); ++n)
+    {
+      int o = orphans[n];
+      if(sink[o])
+        AdoptSink(o);
+      else
+        AdoptSource(o);
+    }
+    orphans.clear();
+  }
+
+  return flow;
+}
+
+void GridGraphCut::Augment(int s, int arc)
+{
+  int t = Head(s, arc);
+  float bottleneck = cap[4*s + arc];
+
+  // bottleneck on the source side, from s back to the source
+  int p;
+  for(p = s; parent[p] != TERMINAL; p = Head(p, parent[p]))
+    bottleneck = std::min(bottleneck, cap[4*Head(p, parent[p]) + (parent[p]^1)]);
+  bottleneck = std::min(bottleneck, terminal[p]);
+
+  // bottleneck on the sink side, from t to the sink
+  for(p = t; parent[p] != TERMINAL; p = Head(p, parent[p]))
+    bottleneck = std::min(bottleneck, cap[4*p + parent[p]]);
+  bottleneck = std::min(bottleneck, -terminal[p]);
+
+  cap[4*s + arc] -= bottleneck;
+  cap[4*t + (arc^1)] += bottleneck;
+
+  // push along the source side
+  for(p = s; parent[p] != TERMINAL; )
+  {
+    int a = parent[p];
+    int q = Head(p, a);
+
+    cap[4*q + (a^1)] -= bottleneck;
+    cap[4*p + a] += bottleneck;
+    if(cap[4*q + (a^1)] == 0)
+    {
+      parent[p] = ORPHAN;
+      orphans.push_back(p);
+    }
+    p = q;
+  }
+  terminal[p] -= bottleneck;
+  if(terminal[p] == 0)
+  {
+    parent[p] = ORPHAN;
+    orphans.push_back(p);
+  }
+
+  // push along the sink side
+  for(p = t; parent[p] != TERMINAL; )
+  {
+    int a = parent[p];
+    int q = Head(p, a);
+
+    cap[4*p + a] -= bottleneck;
+    cap[4*q + (a^1)] += bottleneck;
+    if(cap[4*p + a] == 0)
+    {
+      parent[p] = ORPHAN;
+      orphans.push_back(p);
+    }
+    p = q;
+  }
+  terminal[p] += bottleneck;
+  if(terminal[p] == 0)
+  {
+    parent[p] = ORPHAN;
+    orphans.push_back(p);
+  }
+
+  flow += bottleneck;
+}
+
+void GridGraphCut::AdoptSource(int p)
+{
+  int best = NO_PARENT;
+  int d_min = INFINITE_D;
+
+  // look for a neighbour still connected to the source through a non
+  // saturated arc into p, preferring the closest one
+  for(int a = 0; a < 4; ++a)
+  {
+    int q = Head(p, a);
+    if(cap[4*q + (a^1)] <= 0 || sink[q] || parent[q] == NO_PARENT)
+      continue;
+
+    int d = 0;
+    int r = q;
+    for(;;)
+    {
+      if(ts[r] == time)
+      {
+        d += dist[r];
+        break;
+      }
+      int ra = parent[r];
+      ++d;
+      if(ra == TERMINAL)
+      {
+        ts[r] = time;
+        dist[r] = 1;
+        break;
+      }
+      if(ra == ORPHAN)
+      {
+        d = INFINITE_D;
+        break;
+      }
+      r = Head(r, ra);
+    }
+
+    if(d < INFINITE_D)
+    {
+      if(d < d_min)
+      {
+        best = a;
+        d_min = d;
+      }
+      for(r = q; ts[r] != time; r = Head(r, parent[r]))
+      {
+        ts[r] = time;
+        dist[r] = d--;
+      }
+    }
+  }
+
+  if(best != NO_PARENT)
+  {
+    parent[p] = best;
+    ts[p] = time;
+    dist[p] = d_min + 1;
+    return;
+  }
+
+  // no parent found, p becomes free and its children orphans
+  for(int a = 0; a < 4; ++a)
+  {
+    int q = Head(p, a);
+    int qa = parent[q];
+    if(sink[q] || qa == NO_PARENT)
+      continue;
+
+    if(cap[4*q + (a^1)] > 0)
+      SetActive(q);
+    if(qa != TERMINAL && qa != ORPHAN && Head(q, qa) == p)
+    {
+      parent[q] = ORPHAN;
+      orphans.push_back(q);
+    }
+  }
+  parent[p] = NO_PARENT;
+}
+
+void GridGraphCut::AdoptSink(int p)
+{
+  int best = NO_PARENT;
+  int d_min = INFINITE_D;
+
+  // same as AdoptSource with the arcs pointing out of p
+  for(int a = 0; a < 4; ++a)
+  {
+    int q = Head(p, a);
+    if(cap[4*p + a] <= 0 || !sink[q] || parent[q] == NO_PARENT)
+      continue;
+
+    int d = 0;
+    int r = q;
+    for(;;)
+    {
+      if(ts[r] == time)
+      {
+        d += dist[r];
+        break;
+      }
+      int ra = parent[r];
+      ++d;
+      if(ra == TERMINAL)
+      {
+        ts[r] = time;
+        dist[r] = 1;
+        break;
+      }
+      if(ra == ORPHAN)
+      {
+        d = INFINITE_D;
+        break;
+      }
+      r = Head(r, ra);
+    }
+
+    if(d < INFINITE_D)
+    {
+      if(d < d_min)
+      {
+        best = a;
+        d_min = d;
+      }
+      for(r = q; ts[r] != time; r = Head(r, parent[r]))
+      {
+        ts[r] = time;
+        dist[r] = d--;
+      }
+    }
+  }
+
+  if(best != NO_PARENT)
+  {
+    parent[p] = best;
+    ts[p] = time;
+    dist[p] = d_min + 1;
+    return;
+  }
+
+  for(int a = 0; a < 4; ++a)
+  {
+    int q = Head(p, a);
+    int qa = parent[q];
+    if(!sink[q] || qa == NO_PARENT)
+      continue;
+
+    if(cap[4*p + a] > 0)
+      SetActive(q);
+    if(qa != TERMINAL && qa != ORPHAN && Head(q, qa) == p)
+    {
+      parent[q] = ORPHAN;
+      orphans.push_back(q);
+    }
+  }
+  parent[p] = NO_PARENT;
+}
@@ -0,0 +1,92 @@
+/*
+This file is part of BGSLibrary.
+
+BGSLibrary is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BGSLibrary is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef GRAPH_CUT_H
+#define GRAPH_CUT_H
+
+#include <vector>
+
+namespace Algorithms
+{
+  namespace BackgroundSubtraction
+  {
+    /************************************************************************/
+    /* Max-flow/min-cut on a 4-connected grid (Boykov-Kolmogorov), used to   */
+    /* find the exact minimum of a binary MRF with Potts pair terms.         */
+    /************************************************************************/
+    class GridGraphCut
+    {
+    public:
+      GridGraphCut();
+
+      // Size the graph, buffers are only reallocated when the size changes
+      void Reset(int width, int height);
+
+      // Cost of giving node (i,j) label 0 and label 1
+      void SetUnary(int i, int j, double cost0, double cost1);
+      // Cost added when two neighbours take different labels
+      void SetPairwise(double cost);
+
+      double MaxFlow();
+
+      // Label of node (i,j) in the minimum cut, 0 (source side) or 1
+      inline int Label(int i, int j) const
+      {
+        int p = Node(i,j);
+        return (parent[p] != NO_PARENT && !sink[p]) ? 0 : 1;
+      }
+
+    private:
+      // Nodes are kept with a border of one guard node on each side. Guard
+      // nodes have no capacity, so they are never reached by the search.
+      inline int Node(int i, int j) const { return (i+1)*stride + j + 1; }
+      inline int Head(int p, int arc) const { return p + offset[arc]; }
+
+      void SetActive(int p);
+      int NextActive();
+      void Augment(int p, int arc);
+      void AdoptSource(int p);
+      void AdoptSink(int p);
+
+      // arcs north, south, west, east; arc^1 is the reverse arc
+      static const int NO_PARENT = -1;
+      static const int TERMINAL  = 4;
+      static const int ORPHAN    = 5;
+      static const int INFINITE_D = 1000000000;
+
+      int width, height, stride;
+      int offset[4];
+      double flow;
+      int time;
+
+      // residual capacity of the 4 arcs leaving each node
+      std::vector<float> cap;
+      // residual terminal capacity, > 0 from the source, < 0 to the sink
+      std::vector<float> terminal;
+      std::vector<int> parent;
+      std::vector<unsigned char> sink;
+      std::vector<int> ts, dist;
+
+      // FIFO of active nodes linked through next, the last node points to itself
+      std::vector<int> next;
+      int queue_first, queue_last;
+
+      std::vector<int> orphans;
+    };
+  }
+}
+
+#endif
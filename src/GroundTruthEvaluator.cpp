@@ -0,0 +1,296 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+#include "GroundTruthEvaluator.h"
+#include "PrefetchFrameReader.h"
+#include "MaskArchive.h"
+
+
+double FrameScore::FMeasure() const
+{
+    double p = Precision();
+    double r = Recall();
+    return p + r > 0. ? 2.*p*r/(p + r) : 0.;
+}
+
+
+// True, false positive and false negative pixels of n words of bits
+static void count_bits_generic(const uint64_t* mask, const uint64_t* truth, size_t n,
+                               uint64_t& tp, uint64_t& fp, uint64_t& fn)
+{
+    for (size_t w = 0; w < n; ++w) {
+        tp += __builtin_popcountll(mask[w] & truth[w]);
+        fp += __builtin_popcountll(mask[w] & ~truth[w]);
+        fn += __builtin_popcountll(~mask[w] & truth[w]);
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// Same loop built for the POPCNT instruction, picked at run time since the
+// default flags do not assume it
+__attribute__((target("popcnt")))
+static void count_bits_popcnt(const uint64_t* mask, const uint64_t* truth, size_t n,
+                              uint64_t& tp, uint64_t& fp, uint64_t& fn)
+{
+    for (size_t w = 0; w < n; ++w) {
+        tp += __builtin_popcountll(mask[w] & truth[w]);
+        fp += __builtin_popcountll(mask[w] & ~truth[w]);
+        fn += __builtin_popcountll(~mask[w] & truth[w]);
+    }
+}
+
+static void count_bits(const uint64_t* mask, const uint64_t* truth, size_t n,
+                       uint64_t& tp, uint64_t& fp, uint64_t& fn)
+{
+    static const bool popcnt = __builtin_cpu_supports("popcnt");
+    if (popcnt)
+        count_bits_popcnt(mask, truth, n, tp, fp, fn);
+    else
+        count_bits_generic(mask, truth, n, tp, fp, fn);
+}
+#else
+static void count_bits(const uint64_t* mask, const uint64_t* truth, size_t n,
+                       uint64_t& tp, uint64_t& fp, uint64_t& fn)
+{
+    count_bits_generic(mask, truth, n, tp, fp, fn);
+}
+#endif
+
+// Frame number of a ground-truth file: the last digits of its name
+static bool frame_number(const string& file, int& frame)
+{
+    string stem = boost::filesystem::path(file).stem().string();
+
+    size_t end = stem.find_last_of("0123456789");
+    if (end == string::npos)
+        return false;
+
+    size_t begin = end;
+    while (begin > 0 && isdigit((unsigned char)stem[begin - 1]))
+        --begin;
+
+    frame = atoi(stem.substr(begin, end - begin + 1).c_str());
+    return true;
+}
+
+
+GroundTruthEvaluator::GroundTruthEvaluator()
+{
+    depth     = 0;
+    next_load = 0;
+    loaded    = false;
+    stop      = false;
+}
+
+GroundTruthEvaluator::~GroundTruthEvaluator()
+{
+    Close();
+}
+
+bool GroundTruthEvaluator::Open(const string& dir, int first, int last, int _depth)
+{
+    Close();
+
+    std::vector<string> images;
+    if (!PrefetchFrameReader::ListImageFiles(dir, images))
+        return false;
+
+    files.clear();
+    for (size_t k = 0; k < images.size(); ++k) {
+        int frame;
+        if (frame_number(images[k], frame) && frame >= first && frame <= last)
+            files.push_back(std::make_pair(frame, images[k]));
+    }
+    std::sort(files.begin(), files.end());
+
+    if (files.empty())
+        return false;
+
+    depth     = std::max(_depth, 1);
+    next_load = 0;
+    loaded    = false;
+    stop      = false;
+    queue.clear();
+    scores.clear();
+
+    loader = std::thread(&GroundTruthEvaluator::Load, this);
+
+    return true;
+}
+
+void GroundTruthEvaluator::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    truth_taken.notify_all();
+
+    if (loader.joinable())
+        loader.join();
+    queue.clear();
+}
+
+void GroundTruthEvaluator::Load()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    for (;;) {
+        truth_taken.wait(lock, [this] { return stop || queue.size() < depth; });
+        if (stop || next_load >= files.size())
+            break;
+
+        size_t k = next_load++;
+        lock.unlock();
+
+        Truth truth;
+        truth.frame = files[k].first;
+        Mat image = imread(files[k].second, CV_LOAD_IMAGE_GRAYSCALE);
+        truth.cols = image.cols;
+        truth.rows = image.rows;
+        if (!image.empty()) {
+            truth.bits.assign(mask_words((size_t)image.cols*image.rows), 0);
+            pack_mask_bits(image, (unsigned char*)&truth.bits[0]);
+        }
+
+        lock.lock();
+        queue.push_back(truth);
+        truth_ready.notify_all();
+    }
+
+    // no more frames to wait for
+    loaded = true;
+    truth_ready.notify_all();
+}
+
+bool GroundTruthEvaluator::GetTruth(int frame, Size size, std::vector<uint64_t>& bits)
+{
+    if (!IsOpen())
+        return false;
+
+    Truth truth;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+
+        // drop the ground truth of frames that were not given
+        for (;;) {
+            truth_ready.wait(lock, [this] {
+                return !queue.empty() || loaded;
+            });
+            if (queue.empty() || queue.front().frame >= frame)
+                break;
+            queue.pop_front();
+            truth_taken.notify_all();
+        }
+
+        if (queue.empty() || queue.front().frame != frame)
+            return false;
+
+        std::swap(truth, queue.front());
+        queue.pop_front();
+    }
+    truth_taken.notify_all();
+
+    if (truth.bits.empty())
+        return false;
+
+    // ground truth of another size is compared at the size of the mask
+    if (truth.cols != size.width || truth.rows != size.height) {
+        Mat image(truth.rows, truth.cols, CV_8UC1), scaled;
+        unpack_mask_bits((const unsigned char*)&truth.bits[0], image);
+        resize(image, scaled, size, 0, 0, INTER_NEAREST);
+        truth.bits.assign(mask_words((size_t)size.width*size.height), 0);
+        pack_mask_bits(scaled, (unsigned char*)&truth.bits[0]);
+    }
+
+    std::swap(bits, truth.bits);
+
+    return true;
+}
+
+FrameScore GroundTruthEvaluator::Score(int frame, const Mat& mask,
+                                       const std::vector<uint64_t>& truth,
+                                       std::vector<uint64_t>& bits)
+{
+    size_t n = (size_t)mask.cols*mask.rows;
+    bits.assign(mask_words(n), 0);
+    pack_mask_bits(mask, (unsigned char*)&bits[0]);
+
+    // bits past the last pixel are zero in both
+    FrameScore score;
+    score.frame = frame;
+    score.tp = score.fp = score.fn = 0;
+    count_bits(&bits[0], &truth[0], bits.size(), score.tp, score.fp, score.fn);
+    score.tn = n - score.tp - score.fp - score.fn;
+
+    return score;
+}
+
+bool GroundTruthEvaluator::Evaluate(int frame, const Mat& mask)
+{
+    if (mask.type() != CV_8UC1 || !GetTruth(frame, mask.size(), truthBits))
+        return false;
+
+    scores.push_back(Score(frame, mask, truthBits, maskBits));
+
+    return true;
+}
+
+FrameScore GroundTruthEvaluator::Total(const std::vector<FrameScore>& scores)
+{
+    FrameScore total;
+    total.frame = scores.size();
+    total.tp = total.fp = total.tn = total.fn = 0;
+
+    for (size_t k = 0; k < scores.size(); ++k) {
+        total.tp += scores[k].tp;
+        total.fp += scores[k].fp;
+        total.tn += scores[k].tn;
+        total.fn += scores[k].fn;
+    }
+
+    return total;
+}
+
+bool GroundTruthEvaluator::WriteSummary(const string& filename, const string& header,
+                                        const std::vector<FrameScore>& scores)
+{
+    std::ofstream out(filename.c_str());
+    if (!out.is_open())
+        return false;
+
+    out << header << "\n";
+    out << "# frame TP FP TN FN precision recall fmeasure\n";
+    for (size_t k = 0; k < scores.size(); ++k) {
+        const FrameScore& s = scores[k];
+        out << s.frame << " " << s.tp << " " << s.fp << " " << s.tn << " " << s.fn << " "
+            << s.Precision() << " " << s.Recall() << " " << s.FMeasure() << "\n";
+    }
+
+    // frame count in place of the frame number
+    FrameScore t = Total(scores);
+    out << "# total frames TP FP TN FN precision recall fmeasure\n";
+    out << "# " << t.frame << " " << t.tp << " " << t.fp << " " << t.tn << " " << t.fn << " "
+        << t.Precision() << " " << t.Recall() << " " << t.FMeasure() << "\n";
+
+    return true;
+}
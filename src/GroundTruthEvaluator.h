@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _GROUND_TRUTH_EVALUATOR_H
+#define _GROUND_TRUTH_EVALUATOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using std::string;
+
+
+// Confusion counts of one frame, pixels above 127 are foreground
+struct FrameScore
+{
+    int      frame;
+    uint64_t tp;
+    uint64_t fp;
+    uint64_t tn;
+    uint64_t fn;
+
+    double Precision() const { return tp + fp > 0 ? (double)tp/(tp + fp) : 0.; };
+    double Recall()    const { return tp + fn > 0 ? (double)tp/(tp + fn) : 0.; };
+    double FMeasure()  const;
+};
+
+
+/*
+ * Scores the masks of a driver against a directory of ground-truth images
+ * while the sequence is processed, instead of writing the masks and
+ * reading them back with pmbgs. The frame number of a ground-truth image
+ * is the last number in its file name (e.g. 2370.png, gt_002370.png).
+ *
+ * A helper thread loads the ground truth of the next frames ahead and
+ * keeps it bit packed, so scoring a mask is a popcount over 64 bit words.
+ */
+class GroundTruthEvaluator
+{
+
+public:
+
+    GroundTruthEvaluator();
+    ~GroundTruthEvaluator();
+
+    // Ground truth of frames first to last, depth images loaded ahead
+    bool Open(const string& dir, int first, int last, int depth = 8);
+    // Score the mask of a frame, false when the frame has no ground truth.
+    // Frames must be given in increasing order.
+    bool Evaluate(int frame, const Mat& mask);
+    void Close();
+
+    bool IsOpen() const { return loader.joinable(); };
+
+    // Ground truth of a frame bit packed at the given size, for scoring
+    // several masks of the same frame. False when the frame has none.
+    bool GetTruth(int frame, Size size, std::vector<uint64_t>& bits);
+    // Score a mask against ground truth from GetTruth(), bits is scratch
+    static FrameScore Score(int frame, const Mat& mask, const std::vector<uint64_t>& truth,
+                            std::vector<uint64_t>& bits);
+
+    // Totals over all the frames scored so far
+    FrameScore Total() const { return Total(scores); };
+    const std::vector<FrameScore>& Scores() const { return scores; };
+
+    // Per frame counts and the totals, header is written as a comment
+    bool WriteSummary(const string& filename, const string& header) const
+    {
+        return WriteSummary(filename, header, scores);
+    };
+
+    static FrameScore Total(const std::vector<FrameScore>& scores);
+    static bool WriteSummary(const string& filename, const string& header,
+                             const std::vector<FrameScore>& scores);
+
+private:
+
+    struct Truth
+    {
+        int frame;
+        int cols;
+        int rows;
+        std::vector<uint64_t> bits;
+    };
+
+    void Load();
+
+    std::vector<std::pair<int, string> > files;     // (frame, path) in order
+    std::deque<Truth> queue;
+    size_t depth;
+    size_t next_load;
+    bool loaded;            // the helper has loaded all the files
+    bool stop;
+
+    std::thread loader;
+    std::mutex mtx;
+    std::condition_variable truth_ready;
+    std::condition_variable truth_taken;
+
+    std::vector<uint64_t> truthBits;
+    std::vector<uint64_t> maskBits;
+    std::vector<FrameScore> scores;
+
+};
+
+
+#endif
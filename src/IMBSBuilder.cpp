@@ -31,6 +31,8 @@ const double       IMBSBuilder::DefaultTau_h                  = 40.;
 const double       IMBSBuilder::DefaultMinArea                = 30.;
 const double       IMBSBuilder::DefaultPersistencePeriod      = DefaultSamplingPeriod*DefaultNumSamples/3.;
 const bool         IMBSBuilder::DefaultMorphologicalFiltering = false;
+const int          IMBSBuilder::DefaultModelUpdateInterval    = 1;
+const int          IMBSBuilder::DefaultWarmupFrames           = 50;
 
 
 IMBSBuilder::IMBSBuilder()
@@ -41,6 +43,7 @@ IMBSBuilder::IMBSBuilder()
     nchannels = 0;
     has_been_initialized = false;
     frame_counter = 0;
+    setupTiming();
 
 }
 
@@ -52,6 +55,7 @@ IMBSBuilder::IMBSBuilder(int _col, int _row, int _nchannels)
     nchannels = _nchannels;
     has_been_initialized = false;
     frame_counter = 0;
+    setupTiming();
 
 }
 
@@ -65,6 +69,7 @@ IMBSBuilder::IMBSBuilder(Size _size, int _type)
     nchannels = CV_MAT_CN(frameType);
     has_been_initialized = false;
     frame_counter = 0;
+    setupTiming();
 }
 
 
@@ -80,12 +85,27 @@ void IMBSBuilder::Initialization()
 {
 
     if (rows != 0 && cols != 0 && nchannels != 0) {
+
+        // IMBS subtracts every frame but only samples the background every
+        // samplingPeriod ms. Sample at most once every modelUpdateInterval
+        // frames and drop samples so that the time window covered by the
+        // model (numSamples*samplingPeriod) stays the same.
+        double       modelSamplingPeriod = samplingPeriod;
+        unsigned int modelNumSamples     = numSamples;
+        double       intervalPeriod      = modelUpdateInterval*1000./fps;
+
+        if (intervalPeriod > samplingPeriod) {
+            modelSamplingPeriod = intervalPeriod;
+            modelNumSamples = (unsigned int)(numSamples*samplingPeriod/intervalPeriod + 0.5);
+            modelNumSamples = std::max(modelNumSamples, minBinHeight);
+        }
+
         model = new BackgroundSubtractorIMBS(fps,
                                              fgThreshold,
                                              associationThreshold,
-                                             samplingPeriod,
+                                             modelSamplingPeriod,
                                              minBinHeight,
-                                             numSamples,
+                                             modelNumSamples,
                                              alpha,
                                              beta,
                                              tau_s,
@@ -116,6 +136,8 @@ void IMBSBuilder::GetForeground(OutputArray mask)
 
 void IMBSBuilder::Update(InputArray frame, OutputArray mask) 
 {
+    StageTimer::Clock::time_point begin = StageTimer::Clock::now();
+
     Mat Image = frame.getMat();
     Mat Foreground(Image.size(),CV_8U,Scalar::all(0));
 
@@ -131,10 +153,15 @@ void IMBSBuilder::Update(InputArray frame, OutputArray mask)
     }
 
     //get the fgmask and update the background model
+    StageTimer::Clock::time_point t = StageTimer::Clock::now();
     model->apply(Image, Foreground);
+    timing.Mark(stageApply, t);
+
     Foreground.copyTo(mask);
     frame_counter += 1;
 
+    timing.Mark(stageFrame, begin);
+    duration = timing.Last(stageFrame);
 }
 
 
@@ -154,6 +181,8 @@ void IMBSBuilder::loadDefaultParameters()
     minArea                = DefaultMinArea;
     persistencePeriod      = DefaultPersistencePeriod;
     morphologicalFiltering = DefaultMorphologicalFiltering;
+    modelUpdateInterval    = DefaultModelUpdateInterval;
+    warmupFrames           = DefaultWarmupFrames;
 }
 
 string IMBSBuilder::PrintParameters()
@@ -173,7 +202,9 @@ string IMBSBuilder::PrintParameters()
     << "Tau_h="                  << tau_h                    << " " 
     << "MinArea="                << minArea                  << " " 
     << "PersistencePeriod="      << persistencePeriod        << " " 
-    << "MorphologicalFiltering=" << morphologicalFiltering; 
+    << "MorphologicalFiltering=" << morphologicalFiltering   << " " 
+    << "ModelUpdateInterval="    << modelUpdateInterval      << " " 
+    << "WarmupFrames="           << warmupFrames; 
 
     return str.str();
 
@@ -191,26 +222,7 @@ void IMBSBuilder::LoadConfigParameters()
 
     if ( exists(filename) && is_regular_file(filename) ) {
         
-        FileStorage fs(filename, FileStorage::READ);
-       
-        fps                           = (int)fs["Fps"];
-        fgThreshold                   = (int)   fs["FgThreshold"];
-        associationThreshold          = (int)   fs["AssociationThreshold"];
-        samplingPeriod                = (double)fs["SamplingPeriod"];
-        minBinHeight                  = (int)   fs["MinBinHeight"];
-        numSamples                    = (int)   fs["NumSamples"];
-        alpha                         = (double)fs["Alpha"];
-        beta                          = (double)fs["Beta"];
-        tau_s                         = (double)fs["Tau_s"];
-        tau_h                         = (double)fs["Tau_h"];
-        minArea                       = (double)fs["MinArea"];
-        persistencePeriod             = (double)fs["PersistencePeriod"];
-        morphologicalFiltering        = (int)   fs["MorphologicalFiltering"];
-
-        cout << "Just for debugging: " << persistencePeriod << endl;
-        cout << "Just for debugging: " << fps << endl;
-
-        fs.release();
+        LoadConfigParameters(filename);
     }
     else {
         path p("config");
@@ -232,6 +244,8 @@ void IMBSBuilder::LoadConfigParameters()
         fs << "MinArea"                << minArea                  ; 
         fs << "PersistencePeriod"      << persistencePeriod        ; 
         fs << "MorphologicalFiltering" << (int)morphologicalFiltering; 
+        fs << "ModelUpdateInterval"    << modelUpdateInterval      ; 
+        fs << "WarmupFrames"           << warmupFrames             ; 
 
         fs.release();
 
@@ -239,6 +253,43 @@ void IMBSBuilder::LoadConfigParameters()
 
 }
 
+void IMBSBuilder::LoadConfigParameters(const string& filename)
+{
+    FileStorage fs(filename, FileStorage::READ);
+   
+    fps                           = (int)fs["Fps"];
+    fgThreshold                   = (int)   fs["FgThreshold"];
+    associationThreshold          = (int)   fs["AssociationThreshold"];
+    samplingPeriod                = (double)fs["SamplingPeriod"];
+    minBinHeight                  = (int)   fs["MinBinHeight"];
+    numSamples                    = (int)   fs["NumSamples"];
+    alpha                         = (double)fs["Alpha"];
+    beta                          = (double)fs["Beta"];
+    tau_s                         = (double)fs["Tau_s"];
+    tau_h                         = (double)fs["Tau_h"];
+    minArea                       = (double)fs["MinArea"];
+    persistencePeriod             = (double)fs["PersistencePeriod"];
+    morphologicalFiltering        = (int)   fs["MorphologicalFiltering"];
+
+    // Optional entries, older config files do not have them
+    if (!fs["ModelUpdateInterval"].empty())
+        modelUpdateInterval       = std::max(1, (int)fs["ModelUpdateInterval"]);
+    if (!fs["WarmupFrames"].empty())
+        warmupFrames              = std::max(0, (int)fs["WarmupFrames"]);
+
+    fs.release();
+}
+
+
+void IMBSBuilder::setupTiming()
+{
+    // apply() builds the background, gets the foreground and suppresses
+    // shadows and small areas inside libbgs, it is timed as one stage
+    duration   = 0.;
+    timing     = StageTimer("model");
+    stageApply = timing.Stage("apply");
+    stageFrame = timing.Stage("frame");
+}
 
 string IMBSBuilder::ElapsedTimeAsString()
 {
@@ -248,4 +299,30 @@ string IMBSBuilder::ElapsedTimeAsString()
 }
 
 
+int IMBSBuilder::PixelStateSize()
+{
+    return has_been_initialized ? 6*model->getMaxBgBins() : 0;
+}
 
+string IMBSBuilder::PixelStateLayout()
+{
+    std::stringstream str;
+    str << "{height,valid,fg,b,g,r}x" << (has_been_initialized ? model->getMaxBgBins() : 0);
+    return str.str();
+}
+
+void IMBSBuilder::PixelState(Point p, float* state)
+{
+    if (!has_been_initialized)
+        return;
+
+    const BackgroundSubtractorIMBS::BgModel* bin = model->getPixelModel(p.y*cols + p.x);
+    for (unsigned int k = 0; k < model->getMaxBgBins(); ++k, state += 6) {
+        state[0] = bin->counter[k];
+        state[1] = bin->isValid[k];
+        state[2] = bin->isFg[k];
+        state[3] = bin->values[k][0];
+        state[4] = bin->values[k][1];
+        state[5] = bin->values[k][2];
+    }
+}
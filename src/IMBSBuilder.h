@@ -21,6 +21,7 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include "IBGSAlgorithm.h"
+#include "StageTimer.h"
 #include "imbs.hpp"
 
 using namespace cv;
@@ -40,6 +41,8 @@ public:
     ~IMBSBuilder();
     void SetAlgorithmParameters()  {};
     void LoadConfigParameters();
+    // Parameters of another config file, e.g. one configuration of a sweep
+    void LoadConfigParameters(const string& filename);
     void SaveConfigParameters() {};
     void Initialization();
     void GetBackground(OutputArray);
@@ -49,11 +52,27 @@ public:
     void SaveModel() {};
     string PrintParameters();
     const string Name() {return AlgorithmName; };
+    // Milliseconds of the last Update(), Timing() has each of its stages
     string ElapsedTimeAsString();
     double ElapsedTime(){ return duration; };
+    const StageTimer& Timing() const { return timing; };
+
+    // Frames the model needs before its masks are worth evaluating, the
+    // drivers start that many frames before the --range start with --seek
+    int WarmupFrames() const { return warmupFrames; };
+
+    // ModelUpdateInterval without a config file, call before Initialization()
+    void SetModelUpdateInterval(int k) { modelUpdateInterval = std::max(1, k); };
+
+    // Model state of a pixel for the pixel trace (PixelTrace.h), call
+    // after the first Update(). PixelStateLayout() names the values.
+    int    PixelStateSize();
+    string PixelStateLayout();
+    void   PixelState(Point p, float* state);
 
 private:
     void loadDefaultParameters();
+    void setupTiming();
 
     //int           FramesToLearn;
     //int           SequenceLength;
@@ -74,6 +93,8 @@ private:
     Size frameSize;
     int  frameType;
     double duration;
+    StageTimer timing;
+    int  stageApply, stageFrame;
 
     //unsigned char *FilterFGImage;
     static const string AlgorithmName;
@@ -97,6 +118,8 @@ private:
     double       minArea;
     double       persistencePeriod;
     bool         morphologicalFiltering;
+    int          modelUpdateInterval;
+    int          warmupFrames;
 
     static const double       DefaultFps;
     static const unsigned int DefaultFgThreshold;
@@ -111,6 +134,8 @@ private:
     static const double       DefaultMinArea;
     static const double       DefaultPersistencePeriod;
     static const bool         DefaultMorphologicalFiltering;
+    static const int          DefaultModelUpdateInterval;
+    static const int          DefaultWarmupFrames;
 
 };
 
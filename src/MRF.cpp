@@ -0,0 +1,1065 @@
+/*
+This file is part of BGSLibrary.
+
+BGSLibrary is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BGSLibrary is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "MRF.h"
+#include "ParallelRows.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace Algorithms::BackgroundSubtraction;
+using namespace Algorithms::BackgroundSubtraction::BgsClient;
+
+//init the basic MRF
+MRF::MRF()
+{
+  in_image = out_image = NULL;
+  width = height = 0;
+
+  no_regions = 2;
+  beta = 2.8;
+  t = 10;
+
+  T0 = 10;
+  T = T0;
+  c = 0.98;
+
+  alpha = 0.1;
+
+  E = E_old = 0;
+  K = 0;
+
+  stride = 0;
+  classes = NULL;
+  in_image_data = NULL;
+  local_evidence = NULL;
+}
+
+//init the MRF with time constraints
+MRF_TC::MRF_TC()
+{
+  beta_time = 0.9;
+  background2 = NULL;
+  background.ReleaseMemory(false);
+  old_labeling = NULL;
+  num_modes = 1;
+  queued = NULL;
+  visits = 0;
+  threads = 0;
+  noise_floor = 1.f;
+  time_budget = 0;
+  iteration_budget = 0;
+  budget_hit = false;
+  BuildEnergyTables();
+}
+
+MRF_TC::~MRF_TC()
+{
+  ReleaseBuffers();
+}
+
+void MRF_TC::ReleaseBuffers()
+{
+  delete[] classes;
+  delete[] old_labeling;
+  delete[] in_image_data;
+  delete[] local_evidence;
+  delete[] queued;
+
+  classes = NULL;
+  old_labeling = NULL;
+  in_image_data = NULL;
+  local_evidence = NULL;
+  queued = NULL;
+}
+
+double MRF_TC::TimeEnergy2(int i, int j, int label)
+{
+  if(old_labeling[Index(i,j)] == label*255)
+    return -beta_time;
+  else
+    return beta_time;
+}
+
+void MRF_TC::OnIterationOver2(void)
+{
+  CreateOutput2();
+}
+
+void MRF_TC::Build_Classes_OldLabeling_InImage_LocalEnergy()
+{
+  ReleaseBuffers();
+
+  // one guard pixel on each side, rows padded to 16 bytes
+  stride = (width + 2 + 15) & ~15;
+  int size = (height + 2)*stride;
+
+  classes = new unsigned char[size];
+  old_labeling = new unsigned char[size];
+  in_image_data = new unsigned char[size];
+  local_evidence = new float[2*size];
+  queued = new unsigned char[size];
+
+  std::fill(classes, classes + size, GUARD_LABEL);
+  std::fill(old_labeling, old_labeling + size, 0);
+  std::fill(in_image_data, in_image_data + size, 0);
+  std::fill(local_evidence, local_evidence + 2*size, 0.f);
+  std::fill(queued, queued + size, 0);
+
+  active.reserve(width*height);
+  next_active.reserve(width*height);
+}
+
+void MRF_TC::InitEvidence2(GMM *gmm, const PackedHMM &hmm, IplImage *labeling)
+{
+  // previous labels given by the caller
+  unsigned char *labeling_data = (unsigned char *)(labeling->imageData);
+
+  for(int i = 0; i < height; ++i)
+    std::copy(labeling_data + i*labeling->widthStep,
+              labeling_data + i*labeling->widthStep + width,
+              old_labeling + Index(i,0));
+
+  ComputeEvidence2(gmm, hmm);
+}
+
+void MRF_TC::InitEvidence2(GMM *gmm, const PackedHMM &hmm)
+{
+  // the input labels of the previous call become the previous labels
+  std::swap(old_labeling, in_image_data);
+
+  ComputeEvidence2(gmm, hmm);
+}
+
+void MRF_TC::PushLabels()
+{
+  std::swap(old_labeling, in_image_data);
+
+  unsigned char *in_data = (unsigned char *)(in_image->imageData);
+
+  for(int i = 0; i < height; ++i)
+    std::copy(in_data + i*in_image->widthStep,
+              in_data + i*in_image->widthStep + width,
+              in_image_data + Index(i,0));
+}
+
+namespace
+{
+  const float MIN_PROBABILITY = 1e-6f;
+  // foreground colours are taken as uniform over the RGB cube, 3*log(256)
+  const float FORE_ENERGY = 16.635532f;
+  const float TWO_PI = 6.2831853f;
+
+  // EstimateNoiseFloor samples one pixel in NOISE_STEP x NOISE_STEP. The
+  // median of |x - mu|^2 over three channels is 2.366 variances for
+  // Gaussian noise; the floor is a quarter of that variance, so only mode
+  // variances off by more than 4x are raised.
+  const int NOISE_STEP = 4;
+  const float NOISE_MEDIAN_TO_FLOOR = 1.f/(2.366f*4.f);
+
+  // Natural logarithm for x > 0 from the Cephes logf polynomial, about
+  // 1e-7 relative error. The SSE2 version does the same operations in
+  // the same order, so a pixel gets the same value in either loop.
+  const float SQRTHF = 0.707106781186547524f;
+  const float LOG_P[9] = { 7.0376836292E-2f, -1.1514610310E-1f, 1.1676998740E-1f,
+                           -1.2420140846E-1f, 1.4249322787E-1f, -1.6668057665E-1f,
+                           2.0000714765E-1f, -2.4999993993E-1f, 3.3333331174E-1f };
+  const float LOG_Q1 = -2.12194440e-4f;
+  const float LOG_Q2 = 0.693359375f;
+
+  inline float FastLog(float x)
+  {
+    union { float f; int i; } bits;
+    bits.f = x;
+
+    // x = m * 2^e with m in [0.5, 1)
+    float e = (float)(((bits.i >> 23) & 0xff) - 126);
+    bits.i = (bits.i & 0x807fffff) | 0x3f000000;
+    float m = bits.f;
+
+    bool low = m < SQRTHF;
+    e = e - (low ? 1.f : 0.f);
+    m = (m - 1.f) + (low ? m : 0.f);
+
+    float z = m*m;
+    float y = LOG_P[0];
+    for(int k = 1; k < 9; ++k)
+      y = y*m + LOG_P[k];
+    y = y*m;
+    y = y*z;
+    y = y + e*LOG_Q1;
+    y = y - z*0.5f;
+
+    m = m + y;
+    return m + e*LOG_Q2;
+  }
+
+#ifdef __SSE2__
+  inline __m128 FastLog4(__m128 x)
+  {
+    const __m128 one = _mm_set1_ps(1.f);
+
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)),
+                                             _mm_set1_epi32(126)));
+    bits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x807fffff)), _mm_set1_epi32(0x3f000000));
+    __m128 m = _mm_castsi128_ps(bits);
+
+    __m128 low = _mm_cmplt_ps(m, _mm_set1_ps(SQRTHF));
+    e = _mm_sub_ps(e, _mm_and_ps(low, one));
+    m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(low, m));
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(LOG_P[0]);
+    for(int k = 1; k < 9; ++k)
+      y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(LOG_P[k]));
+    y = _mm_mul_ps(y, m);
+    y = _mm_mul_ps(y, z);
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(LOG_Q1)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+
+    m = _mm_add_ps(m, y);
+    return _mm_add_ps(m, _mm_mul_ps(e, _mm_set1_ps(LOG_Q2)));
+  }
+#endif
+}
+
+void MRF_TC::ComputeEvidence2(GMM *gmm, const PackedHMM &hmm)
+{
+  background = background2;
+
+  // -log of the transitions, [previous label][new label], the table is
+  // shared by every pixel of the scene
+  const HMMTransitions &table = hmm.Transitions();
+  float transition[4];
+  transition[0] = -FastLog(std::max(table.Ab2b, MIN_PROBABILITY));
+  transition[1] = -FastLog(std::max(table.Ab2f, MIN_PROBABILITY));
+  transition[2] = -FastLog(std::max(table.Af2b, MIN_PROBABILITY));
+  transition[3] = -FastLog(std::max(table.Af2f, MIN_PROBABILITY));
+
+  EstimateNoiseFloor(gmm);
+
+  parallel_rows(height, [&](int first, int last)
+  {
+    for(int i = first; i < last; ++i)
+      EvidenceRow(i, gmm, transition);
+  }, threads);
+}
+
+void MRF_TC::EstimateNoiseFloor(GMM *gmm)
+{
+  // A new mode starts at the initial variance of the model and the
+  // variance is clamped, so in a noisy scene it can be far below the
+  // actual noise and every pixel would look like foreground. The noise is
+  // measured on the pixels the input labels call background.
+  noise_samples.clear();
+
+  for(int i = 0; i < height; i += NOISE_STEP)
+  {
+    const unsigned char *in = (unsigned char *)(in_image->imageData) + i*in_image->widthStep;
+    const unsigned char *value = (unsigned char *)(background2->imageData) + i*background2->widthStep;
+    const GMM *mode = gmm + (long)i*width*num_modes;
+
+    for(int j = 0; j < width; j += NOISE_STEP)
+    {
+      if(in[j] == 255)
+        continue;
+
+      const GMM &m = mode[j*num_modes];
+      const unsigned char *v = value + 3*j;
+
+      float dR = (float)v[0] - m.muR;
+      float dG = (float)v[1] - m.muG;
+      float dB = (float)v[2] - m.muB;
+
+      noise_samples.push_back((dR*dR + dG*dG) + dB*dB);
+    }
+  }
+
+  noise_floor = 1.f;
+  if(noise_samples.empty())
+    return;
+
+  std::vector<float>::iterator median = noise_samples.begin() + noise_samples.size()/2;
+  std::nth_element(noise_samples.begin(), median, noise_samples.end());
+  noise_floor = std::max(1.f, *median*NOISE_MEDIAN_TO_FLOOR);
+}
+
+void MRF_TC::EvidenceRow(int i, GMM *gmm, const float *transition)
+{
+  const unsigned char *in = (unsigned char *)(in_image->imageData) + i*in_image->widthStep;
+  const unsigned char *value = (unsigned char *)(background2->imageData) + i*background2->widthStep;
+  const unsigned char *old = old_labeling + Index(i,0);
+  unsigned char *input = in_image_data + Index(i,0);
+  unsigned char *labels = classes + Index(i,0);
+  float *evidence = local_evidence + 2*Index(i,0);
+
+  // labels of the row, read once for the input and the starting labeling
+  for(int j = 0; j < width; ++j)
+  {
+    input[j] = in[j];
+    labels[j] = (in[j] == 255);
+  }
+
+  // Background energy from the dominant mode of the pixel, foreground
+  // energy uniform; both add -log of the hidden state transition chosen
+  // by the previous label.
+  const GMM *mode = gmm + (long)i*width*num_modes;
+  int j = 0;
+
+#ifdef __SSE2__
+  for(; j + 4 <= width; j += 4)
+  {
+    const GMM &m0 = mode[(j+0)*num_modes], &m1 = mode[(j+1)*num_modes];
+    const GMM &m2 = mode[(j+2)*num_modes], &m3 = mode[(j+3)*num_modes];
+    const unsigned char *v = value + 3*j;
+
+    __m128 var = _mm_max_ps(_mm_set_ps(m3.variance, m2.variance, m1.variance, m0.variance), _mm_set1_ps(noise_floor));
+    __m128 dR = _mm_sub_ps(_mm_set_ps(v[9],  v[6], v[3], v[0]), _mm_set_ps(m3.muR, m2.muR, m1.muR, m0.muR));
+    __m128 dG = _mm_sub_ps(_mm_set_ps(v[10], v[7], v[4], v[1]), _mm_set_ps(m3.muG, m2.muG, m1.muG, m0.muG));
+    __m128 dB = _mm_sub_ps(_mm_set_ps(v[11], v[8], v[5], v[2]), _mm_set_ps(m3.muB, m2.muB, m1.muB, m0.muB));
+
+    __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dR, dR), _mm_mul_ps(dG, dG)), _mm_mul_ps(dB, dB));
+    __m128 back = _mm_add_ps(_mm_div_ps(d2, _mm_add_ps(var, var)),
+                             _mm_mul_ps(_mm_set1_ps(1.5f), FastLog4(_mm_mul_ps(_mm_set1_ps(TWO_PI), var))));
+
+    // previous label 255 selects the transitions from foreground
+    int previous;
+    std::memcpy(&previous, old + j, 4);
+    __m128i lanes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(previous), _mm_setzero_si128());
+    lanes = _mm_unpacklo_epi16(lanes, _mm_setzero_si128());
+    __m128 fore = _mm_castsi128_ps(_mm_cmpeq_epi32(lanes, _mm_set1_epi32(255)));
+
+    __m128 to_back = _mm_or_ps(_mm_and_ps(fore, _mm_set1_ps(transition[2])), _mm_andnot_ps(fore, _mm_set1_ps(transition[0])));
+    __m128 to_fore = _mm_or_ps(_mm_and_ps(fore, _mm_set1_ps(transition[3])), _mm_andnot_ps(fore, _mm_set1_ps(transition[1])));
+
+    __m128 e0 = _mm_add_ps(back, to_back);
+    __m128 e1 = _mm_add_ps(_mm_set1_ps(FORE_ENERGY), to_fore);
+
+    _mm_storeu_ps(evidence + 2*j,     _mm_unpacklo_ps(e0, e1));
+    _mm_storeu_ps(evidence + 2*j + 4, _mm_unpackhi_ps(e0, e1));
+  }
+#endif
+
+  for(; j < width; ++j)
+  {
+    const GMM &m = mode[j*num_modes];
+    const unsigned char *v = value + 3*j;
+
+    float var = std::max(m.variance, noise_floor);
+    float dR = (float)v[0] - m.muR;
+    float dG = (float)v[1] - m.muG;
+    float dB = (float)v[2] - m.muB;
+
+    float d2 = (dR*dR + dG*dG) + dB*dB;
+    float back = d2/(var + var) + 1.5f*FastLog(TWO_PI*var);
+
+    const float *to = transition + ((old[j] == 255) ? 2 : 0);
+
+    evidence[2*j + 0] = back + to[0];
+    evidence[2*j + 1] = FORE_ENERGY + to[1];
+  }
+}
+
+void MRF_TC::CreateOutput2()
+{
+  unsigned char *out_data = (unsigned char *)(out_image->imageData);
+
+  for(int i = 0; i < height; ++i)
+  {
+    const unsigned char *labels = classes + Index(i,0);
+    unsigned char *out = out_data + i*out_image->widthStep;
+
+    for(int j = 0; j < width; ++j)
+      out[j] = labels[j]*255;
+  }
+}
+
+double MRF_TC::CalculateEnergy2()
+{
+  double sum_energy = 0.0;
+
+  for(int i = 0; i < height; ++i)
+    for(int j = 0; j < width; ++j)
+      sum_energy += LocalEnergy2(i, j, classes[Index(i,j)]);
+
+  return sum_energy;
+}
+
+double MRF_TC::LocalEnergy2(int i, int j, int label)
+{
+  int idx = Index(i,j);
+  return local_evidence[2*idx + label] + energy_table[EnergyKey(idx) + label];
+}
+
+void MRF_TC::SetBeta(double space, double time)
+{
+  beta = space;
+  beta_time = time;
+  BuildEnergyTables();
+}
+
+void MRF_TC::BuildEnergyTables()
+{
+  for(int time = 0; time < 3; ++time)
+  {
+    for(int zeros = 0; zeros <= 4; ++zeros)
+    {
+      for(int ones = 0; ones <= 4; ++ones)
+      {
+        for(int label = 0; label < 2; ++label)
+        {
+          // neighbours with another label, guards included, add +beta
+          int same = (label == 0) ? zeros : ones;
+          double doubleton = beta*(4 - 2*same);
+
+          // previous label 0, 255 or neither
+          double time_energy = beta_time;
+          if((time == 0 && label == 0) || (time == 1 && label == 1))
+            time_energy = -beta_time;
+
+          energy_table[((time*5 + ones)*5 + zeros)*2 + label] = doubleton + time_energy;
+        }
+      }
+    }
+  }
+}
+
+double MRF_TC::VerifyEnergyTables()
+{
+  double max_error = 0.0;
+
+  for(int i = 0; i < height; ++i)
+  {
+    for(int j = 0; j < width; ++j)
+    {
+      for(int label = 0; label < 2; ++label)
+      {
+        double reference = local_evidence[2*Index(i,j) + label] + Doubleton2(i, j, label) + TimeEnergy2(i, j, label);
+        max_error = std::max(max_error, fabs(LocalEnergy2(i, j, label) - reference));
+      }
+    }
+  }
+
+  return max_error;
+}
+
+double MRF_TC::Doubleton2(int i, int j, int label)
+{
+  const unsigned char *neighbour = classes + Index(i,j);
+  double energy = 0.0;
+
+  energy += (neighbour[-stride] == label) ? -beta : beta; // north
+  energy += (neighbour[ stride] == label) ? -beta : beta; // south
+  energy += (neighbour[-1]      == label) ? -beta : beta; // west
+  energy += (neighbour[ 1]      == label) ? -beta : beta; // east
+
+  return energy;
+}
+
+void MRF_TC::Gibbs2()
+{
+  StartBudget();
+  double summa_deltaE;
+
+  T = T0;
+  E_old = CalculateEnergy2();
+  K = 0;
+
+  do
+  {
+    for(int i = 0; i < height; ++i)
+    {
+      for(int j = 0; j < width; ++j)
+      {
+        double e0 = LocalEnergy2(i, j, 0);
+        double e1 = LocalEnergy2(i, j, 1);
+
+        // probability of the foreground label at temperature T
+        double p1 = 1.0/(1.0 + exp((e1 - e0)/T));
+        double kszi = rand()/(RAND_MAX + 1.0);
+
+        classes[Index(i,j)] = (kszi < p1) ? 1 : 0;
+      }
+    }
+
+    E = CalculateEnergy2();
+    summa_deltaE = fabs(E_old - E);
+    E_old = E;
+
+    T *= c;
+    ++K;
+    OnIterationOver2();
+  }
+  while(summa_deltaE > t && !OverBudget());
+}
+
+void MRF_TC::ICM2()
+{
+  StartBudget();
+  double summa_deltaE;
+
+  E_old = CalculateEnergy2();
+  K = 0;
+
+  do
+  {
+    for(int i = 0; i < height; ++i)
+    {
+      for(int j = 0; j < width; ++j)
+      {
+        double e0 = LocalEnergy2(i, j, 0);
+        double e1 = LocalEnergy2(i, j, 1);
+
+        classes[Index(i,j)] = (e1 < e0) ? 1 : 0;
+      }
+    }
+
+    E = CalculateEnergy2();
+    summa_deltaE = fabs(E_old - E);
+    E_old = E;
+
+    ++K;
+    OnIterationOver2();
+  }
+  while(summa_deltaE > t && !OverBudget());
+}
+
+void MRF_TC::Metropolis2(bool mmd)
+{
+  StartBudget();
+  double summa_deltaE;
+
+  T = T0;
+  E_old = CalculateEnergy2();
+  K = 0;
+
+  do
+  {
+    for(int i = 0; i < height; ++i)
+    {
+      for(int j = 0; j < width; ++j)
+      {
+        int idx = Index(i,j);
+        int label = classes[idx];
+        int r = 1 - label;
+
+        double deltaE = LocalEnergy2(i, j, r) - LocalEnergy2(i, j, label);
+
+        // MMD uses a fixed threshold instead of a random one
+        double kszi = mmd ? log(alpha) : log(rand()/(RAND_MAX + 1.0) + 1e-12);
+
+        if(kszi <= -deltaE/T)
+          classes[idx] = r;
+      }
+    }
+
+    E = CalculateEnergy2();
+    summa_deltaE = fabs(E_old - E);
+    E_old = E;
+
+    T *= c;
+    ++K;
+    OnIterationOver2();
+  }
+  while(summa_deltaE > t && !OverBudget());
+}
+
+double MRF_TC::ParallelEnergy2(int threads)
+{
+  std::vector<double> partial(height, 0.0);
+
+  parallel_rows(height, [&](int first, int last)
+  {
+    for(int i = first; i < last; ++i)
+      for(int j = 0; j < width; ++j)
+        partial[i] += LocalEnergy2(i, j, classes[Index(i,j)]);
+  }, threads);
+
+  double sum_energy = 0.0;
+  for(int i = 0; i < height; ++i)
+    sum_energy += partial[i];
+
+  return sum_energy;
+}
+
+void MRF_TC::CheckerboardRow(int i, int colour, bool band_edge)
+{
+  unsigned char *labels = classes + Index(i,0);
+  const unsigned char *north = labels - stride;
+  const unsigned char *south = labels + stride;
+  const unsigned char *old = old_labeling + Index(i,0);
+  const float *evidence = local_evidence + 2*Index(i,0);
+
+  const float beta2 = (float)(2*beta);
+  const float beta_time2 = (float)(2*beta_time);
+
+  // e1 - e0 without branches: a neighbour labelled 0 adds 2*beta,
+  // labelled 1 subtracts it and a guard pixel adds nothing; the previous
+  // label works the same way.
+  int j = 0;
+
+#ifdef __SSE2__
+  // 16 pixels at a time, the result is kept only for the pixels of this
+  // colour and the others are stored back unchanged. The loads take the
+  // rows above and below whole and the store rewrites the whole row, so
+  // this is only done when those rows belong to the same thread: on the
+  // first and last row of a band they are read or written by the
+  // neighbouring bands during the half sweep.
+  if(!band_edge)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i fore = _mm_set1_epi8((char)255);
+    const __m128i active = ((i + colour) & 1) ? _mm_set1_epi16((short)0xff00) : _mm_set1_epi16(0x00ff);
+    const __m128 vbeta2 = _mm_set1_ps(beta2);
+    const __m128 vbeta_time2 = _mm_set1_ps(beta_time2);
+
+    for(; j + 16 <= width; j += 16)
+    {
+      __m128i current = _mm_loadu_si128((const __m128i *)(labels + j));
+
+      // zeros - ones over the four neighbours, and (old==0) - (old==255),
+      // as signed bytes: a compare gives -1 where it holds
+      __m128i neighbours = zero;
+      const unsigned char *rows[4] = { north + j, south + j, labels + j - 1, labels + j + 1 };
+      for(int n = 0; n < 4; ++n)
+      {
+        __m128i v = _mm_loadu_si128((const __m128i *)rows[n]);
+        neighbours = _mm_add_epi8(neighbours, _mm_sub_epi8(_mm_cmpeq_epi8(v, one), _mm_cmpeq_epi8(v, zero)));
+      }
+      __m128i previous = _mm_loadu_si128((const __m128i *)(old + j));
+      __m128i time = _mm_sub_epi8(_mm_cmpeq_epi8(previous, fore), _mm_cmpeq_epi8(previous, zero));
+
+      // bytes to 32-bit lanes, sign extended, four pixels per group
+      __m128i n16[2] = { _mm_srai_epi16(_mm_unpacklo_epi8(neighbours, neighbours), 8),
+                         _mm_srai_epi16(_mm_unpackhi_epi8(neighbours, neighbours), 8) };
+      __m128i t16[2] = { _mm_srai_epi16(_mm_unpacklo_epi8(time, time), 8),
+                         _mm_srai_epi16(_mm_unpackhi_epi8(time, time), 8) };
+
+      __m128i flip[4];
+      for(int g = 0; g < 4; ++g)
+      {
+        __m128i n32 = (g & 1) ? _mm_unpackhi_epi16(n16[g >> 1], n16[g >> 1]) : _mm_unpacklo_epi16(n16[g >> 1], n16[g >> 1]);
+        __m128i t32 = (g & 1) ? _mm_unpackhi_epi16(t16[g >> 1], t16[g >> 1]) : _mm_unpacklo_epi16(t16[g >> 1], t16[g >> 1]);
+        n32 = _mm_srai_epi32(n32, 16);
+        t32 = _mm_srai_epi32(t32, 16);
+
+        // (background, foreground) pairs of four pixels
+        __m128 a = _mm_loadu_ps(evidence + 2*(j + 4*g));
+        __m128 b = _mm_loadu_ps(evidence + 2*(j + 4*g) + 4);
+        __m128 e0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0));
+        __m128 e1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1));
+
+        // same operations in the same order as the loop below
+        __m128 diff = _mm_add_ps(_mm_add_ps(_mm_sub_ps(e1, e0), _mm_mul_ps(vbeta2, _mm_cvtepi32_ps(n32))),
+                                 _mm_mul_ps(vbeta_time2, _mm_cvtepi32_ps(t32)));
+        flip[g] = _mm_castps_si128(_mm_cmplt_ps(diff, _mm_setzero_ps()));
+      }
+
+      // -1 where label 1 wins, packed back to bytes
+      __m128i best = _mm_packs_epi16(_mm_packs_epi32(flip[0], flip[1]), _mm_packs_epi32(flip[2], flip[3]));
+      best = _mm_and_si128(best, one);
+
+      current = _mm_or_si128(_mm_and_si128(active, best), _mm_andnot_si128(active, current));
+      _mm_storeu_si128((__m128i *)(labels + j), current);
+    }
+  }
+#endif
+
+  // Only the pixels of this colour are evaluated. Their four neighbours
+  // are of the other colour, which no thread writes during this half
+  // sweep, so the rows of the neighbouring bands are only read.
+  for(j += (i + colour) & 1; j < width; j += 2)
+  {
+    int zeros = (north[j] == 0) + (south[j] == 0) + (labels[j-1] == 0) + (labels[j+1] == 0);
+    int ones  = (north[j] == 1) + (south[j] == 1) + (labels[j-1] == 1) + (labels[j+1] == 1);
+    int time  = (old[j] == 0) - (old[j] == 255);
+
+    float diff = evidence[2*j+1] - evidence[2*j] + beta2*(zeros - ones) + beta_time2*time;
+    labels[j] = diff < 0.f;
+  }
+}
+
+void MRF_TC::CheckerboardICM2(int threads)
+{
+  StartBudget();
+  double summa_deltaE;
+
+  E_old = ParallelEnergy2(threads);
+  K = 0;
+
+  do
+  {
+    // pixels of one colour only have neighbours of the other colour, so
+    // every half sweep can update all its pixels at the same time
+    for(int colour = 0; colour < 2; ++colour)
+    {
+      parallel_rows(height, [&](int first, int last)
+      {
+        for(int i = first; i < last; ++i)
+          CheckerboardRow(i, colour, (i == first && first > 0) || (i == last - 1 && last < height));
+      }, threads);
+    }
+
+    E = ParallelEnergy2(threads);
+    summa_deltaE = fabs(E_old - E);
+    E_old = E;
+
+    ++K;
+  }
+  while(summa_deltaE > t && !OverBudget());
+
+  CreateOutput2();
+}
+
+// Change of LocalEnergy2 at idx when the pixel moves to 'label', which is
+// what ICM2 compares. The change of the global energy is returned in
+// global_delta: the pair terms are counted once from each side in
+// CalculateEnergy2, so their change is doubled. Guard neighbours add +beta
+// to both labels and cancel.
+double MRF_TC::FlipEnergy2(int idx, int label, double &global_delta) const
+{
+  int current = classes[idx];
+  const unsigned char *neighbour = classes + idx;
+
+  int same_new = (neighbour[-stride] == label) + (neighbour[stride] == label)
+               + (neighbour[-1] == label) + (neighbour[1] == label);
+  int same_old = (neighbour[-stride] == current) + (neighbour[stride] == current)
+               + (neighbour[-1] == current) + (neighbour[1] == current);
+
+  double unary = local_evidence[2*idx + label] - local_evidence[2*idx + current];
+  double doubleton = -2*beta*(same_new - same_old);
+  double time = 0.0;
+  if(old_labeling[idx] == label*255)
+    time = -2*beta_time;
+  else if(old_labeling[idx] == current*255)
+    time = 2*beta_time;
+
+  global_delta = unary + 2*doubleton + time;
+  return unary + doubleton + time;
+}
+
+void MRF_TC::Activate(int idx)
+{
+  if(classes[idx] == GUARD_LABEL || queued[idx])
+    return;
+
+  queued[idx] = 1;
+  next_active.push_back(idx);
+}
+
+void MRF_TC::ActiveSetICM2()
+{
+  StartBudget();
+  double summa_deltaE;
+
+  // the first sweep visits every pixel in raster order
+  active.clear();
+  for(int i = 0; i < height; ++i)
+    for(int j = 0; j < width; ++j)
+      active.push_back(Index(i,j));
+
+  E_old = E = CalculateEnergy2();
+  K = 0;
+  visits = 0;
+
+  do
+  {
+    summa_deltaE = 0.0;
+    next_active.clear();
+
+    for(size_t n = 0; n < active.size(); ++n)
+    {
+      int idx = active[n];
+      int r = 1 - classes[idx];
+
+      // same decision as ICM2, e(r) < e(label)
+      double deltaE;
+      if(FlipEnergy2(idx, r, deltaE) < 0)
+      {
+        classes[idx] = r;
+        summa_deltaE += deltaE;
+
+        // only the neighbours can change their best label
+        Activate(idx - stride);
+        Activate(idx + stride);
+        Activate(idx - 1);
+        Activate(idx + 1);
+      }
+    }
+    visits += active.size();
+
+    for(size_t n = 0; n < next_active.size(); ++n)
+      queued[next_active[n]] = 0;
+
+    // raster order keeps the next sweep walking forward through memory
+    std::sort(next_active.begin(), next_active.end());
+    active.swap(next_active);
+
+    E = E_old + summa_deltaE;
+    E_old = E;
+
+    ++K;
+  }
+  while(!active.empty() && fabs(summa_deltaE) > t && !OverBudget());
+
+  CreateOutput2();
+}
+
+void MRF_TC::GraphCut2()
+{
+  StartBudget();
+  graph.Reset(width, height);
+
+  for(int i = 0; i < height; ++i)
+  {
+    for(int j = 0; j < width; ++j)
+    {
+      int idx = Index(i,j);
+      graph.SetUnary(i, j,
+                     local_evidence[2*idx + 0] + TimeEnergy2(i, j, 0),
+                     local_evidence[2*idx + 1] + TimeEnergy2(i, j, 1));
+    }
+  }
+
+  // a pair pays -beta when the labels agree and +beta otherwise
+  graph.SetPairwise(2*beta);
+  graph.MaxFlow();
+
+  for(int i = 0; i < height; ++i)
+    for(int j = 0; j < width; ++j)
+      classes[Index(i,j)] = graph.Label(i,j);
+
+  E = CalculateEnergy2();
+  K = 1;
+
+  CreateOutput2();
+}
+
+double MRF_TC::ModelEnergy2()
+{
+  double sum_energy = 0.0;
+
+  for(int i = 0; i < height; ++i)
+  {
+    for(int j = 0; j < width; ++j)
+    {
+      int idx = Index(i,j);
+      int label = classes[idx];
+
+      sum_energy += local_evidence[2*idx + label] + TimeEnergy2(i, j, label);
+
+      // east and south pairs, the border has no pairs
+      if(j < width - 1)
+        sum_energy += (classes[idx + 1] == label) ? -beta : beta;
+      if(i < height - 1)
+        sum_energy += (classes[idx + stride] == label) ? -beta : beta;
+    }
+  }
+
+  return sum_energy;
+}
+
+void MRF_TC::BuildPyramid(int levels)
+{
+  pyramid.resize(levels);
+
+  for(int k = 0; k < levels; ++k)
+  {
+    PyramidLevel &level = pyramid[k];
+    int fine_width  = (k == 0) ? width  : pyramid[k-1].width;
+    int fine_height = (k == 0) ? height : pyramid[k-1].height;
+
+    // buffers are kept between frames while the size does not change
+    if(level.labels.empty() || level.width != (fine_width + 1)/2 || level.height != (fine_height + 1)/2)
+    {
+      level.width  = (fine_width + 1)/2;
+      level.height = (fine_height + 1)/2;
+      level.stride = level.width + 2;
+      level.evidence.resize(2*(level.height + 2)*level.stride);
+      level.labels.assign((level.height + 2)*level.stride, GUARD_LABEL);
+      level.ones.resize(level.width*level.height);
+      level.count.resize(level.width*level.height);
+    }
+    std::fill(level.evidence.begin(), level.evidence.end(), 0.f);
+
+    // foreground pixels of each block, the block takes the majority label
+    std::vector<int> &ones = level.ones, &count = level.count;
+    std::fill(ones.begin(), ones.end(), 0);
+    std::fill(count.begin(), count.end(), 0);
+
+    for(int i = 0; i < fine_height; ++i)
+    {
+      for(int j = 0; j < fine_width; ++j)
+      {
+        int coarse = level.Index(i/2, j/2);
+        float e0, e1;
+        int label;
+
+        if(k == 0)
+        {
+          int idx = Index(i,j);
+          e0 = local_evidence[2*idx + 0] + TimeEnergy2(i, j, 0);
+          e1 = local_evidence[2*idx + 1] + TimeEnergy2(i, j, 1);
+          label = classes[idx];
+        }
+        else
+        {
+          const PyramidLevel &fine = pyramid[k-1];
+          int idx = fine.Index(i,j);
+          e0 = fine.evidence[2*idx + 0];
+          e1 = fine.evidence[2*idx + 1];
+          label = fine.labels[idx];
+        }
+
+        level.evidence[2*coarse + 0] += e0;
+        level.evidence[2*coarse + 1] += e1;
+        ones[(i/2)*level.width + j/2] += label;
+        count[(i/2)*level.width + j/2] += 1;
+      }
+    }
+
+    for(int i = 0; i < level.height; ++i)
+      for(int j = 0; j < level.width; ++j)
+        level.labels[level.Index(i,j)] = 2*ones[i*level.width + j] > count[i*level.width + j];
+  }
+}
+
+int MRF_TC::SweepLevel(PyramidLevel &level, double level_beta)
+{
+  int flips = 0;
+
+  for(int i = 0; i < level.height; ++i)
+  {
+    for(int j = 0; j < level.width; ++j)
+    {
+      int idx = level.Index(i,j);
+      const unsigned char *neighbour = &level.labels[idx];
+
+      int same0 = (neighbour[-level.stride] == 0) + (neighbour[level.stride] == 0)
+                + (neighbour[-1] == 0) + (neighbour[1] == 0);
+      int same1 = (neighbour[-level.stride] == 1) + (neighbour[level.stride] == 1)
+                + (neighbour[-1] == 1) + (neighbour[1] == 1);
+
+      double e0 = level.evidence[2*idx + 0] - level_beta*2*same0;
+      double e1 = level.evidence[2*idx + 1] - level_beta*2*same1;
+
+      unsigned char label = (e1 < e0) ? 1 : 0;
+      if(label != level.labels[idx])
+      {
+        level.labels[idx] = label;
+        ++flips;
+      }
+    }
+  }
+
+  return flips;
+}
+
+void MRF_TC::PyramidICM2(int levels)
+{
+  StartBudget();
+  BuildPyramid(levels);
+  K = 0;
+
+  // solve from the coarsest level down. Level 0 is already half the full
+  // resolution, so a pair of level k stands for 2^(k+1) pairs of the full
+  // image, which is the 2 << k below.
+  for(int k = levels - 1; k >= 0; --k)
+  {
+    PyramidLevel &level = pyramid[k];
+
+    if(k < levels - 1)
+    {
+      const PyramidLevel &coarse = pyramid[k+1];
+      for(int i = 0; i < level.height; ++i)
+        for(int j = 0; j < level.width; ++j)
+          level.labels[level.Index(i,j)] = coarse.labels[coarse.Index(i/2, j/2)];
+    }
+
+    double level_beta = beta*(2 << k);
+    while(!OverBudget() && SweepLevel(level, level_beta) > 0)
+      ++K;
+  }
+
+  for(int i = 0; i < height; ++i)
+    for(int j = 0; j < width; ++j)
+      classes[Index(i,j)] = pyramid[0].labels[pyramid[0].Index(i/2, j/2)];
+
+  // single refinement sweep at full resolution, also when over budget
+  // since it is the only pass at this resolution
+  for(int i = 0; i < height; ++i)
+  {
+    for(int j = 0; j < width; ++j)
+    {
+      double e0 = LocalEnergy2(i, j, 0);
+      double e1 = LocalEnergy2(i, j, 1);
+
+      classes[Index(i,j)] = (e1 < e0) ? 1 : 0;
+    }
+  }
+  ++K;
+
+  E = CalculateEnergy2();
+  CreateOutput2();
+}
+
+void MRF_TC::SetBudget(double milliseconds, int iterations)
+{
+  time_budget = std::max(0.0, milliseconds);
+  iteration_budget = std::max(0, iterations);
+}
+
+void MRF_TC::StartBudget()
+{
+  budget_hit = false;
+  solve_start = std::chrono::steady_clock::now();
+}
+
+bool MRF_TC::OverBudget()
+{
+  if(iteration_budget > 0 && K >= iteration_budget)
+    budget_hit = true;
+
+  if(time_budget > 0)
+  {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - solve_start;
+    if(elapsed.count() >= time_budget)
+      budget_hit = true;
+  }
+
+  return budget_hit;
+}
+
+void MRF_TC::Solve(int solver)
+{
+  switch(solver)
+  {
+    case MRF_SOLVER_CHECKERBOARD: CheckerboardICM2(threads); break;
+    case MRF_SOLVER_ACTIVE_SET:   ActiveSetICM2();      break;
+    case MRF_SOLVER_GRAPH_CUT:    GraphCut2();          break;
+    case MRF_SOLVER_GIBBS:        Gibbs2();             break;
+    case MRF_SOLVER_METROPOLIS:   Metropolis2(false);   break;
+    case MRF_SOLVER_PYRAMID:      PyramidICM2();        break;
+    default:                      ICM2();               break;
+  }
+}
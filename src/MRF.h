@@ -18,89 +18,245 @@ along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
 #define MRF_H
 
 #include "T2FMRF.h"
+#include "GraphCut.h"
+#include <vector>
+#include <chrono>
 
 namespace Algorithms
 {
   namespace BackgroundSubtraction
   {
-    // base class
-    class MRF
+    // This tree's MRF_TC. The bgs library linked in defines classes of the
+    // same names, the nested namespace keeps the two apart.
+    namespace BgsClient
     {
-    public:
-      IplImage *in_image, *out_image;
-      //image's width and height
-      int width, height;
-
-    public:
-      MRF();
-
-    protected:
-
-      //////////////////////////////////////////////////////////////////////////
-      //the number of labeling
-      int no_regions;
-      //potential of Space  Constraint
-      double beta;
-      //terminal condition when (deltaE < t)
-      double t;
-
-      //////////////////////////////////////////////////////////////////////////
-      //for gibbs
-      double T0;
-      //current temperature
-      double T;
-      double c;
-
-      //////////////////////////////////////////////////////////////////////////
-      // alpha value for MMD
-      double alpha;		            
-
-      //////////////////////////////////////////////////////////////////////////
-      //current global energy
-      double E;
-      //old global energy
-      double E_old;
-      //number of iteration
-      int K;
-
-      //////////////////////////////////////////////////////////////////////////
-      //labeling image 
-      int **classes;
-      //input image
-      int **in_image_data;
-      //evidence
-      float ** local_evidence;
-    };
-
-    /************************************************************************/
-    /* the Markov Random Field with time constraints for T2FGMM   */
-    /************************************************************************/
-    class MRF_TC: public MRF
-    {
-    private:
-      double beta_time;
-
-    public:
-      IplImage *background2;
-      RgbImage background;
-      int **old_labeling;
-
-    public:
-      MRF_TC();
-      ~MRF_TC();
-      double TimeEnergy2(int i, int j, int label);
-      void OnIterationOver2(void);
-      void Build_Classes_OldLabeling_InImage_LocalEnergy();
-      void InitEvidence2(GMM *gmm, HMM *hmm, IplImage *labeling);
-      void CreateOutput2();
-      double CalculateEnergy2();
-      double LocalEnergy2(int i, int j, int label);
-      double Doubleton2(int i, int j, int label);
-
-      void Gibbs2();
-      void ICM2();
-      void Metropolis2(bool mmd);
-    };
+      // base class
+      class MRF
+      {
+      public:
+        IplImage *in_image, *out_image;
+        //image's width and height
+        int width, height;
+
+      public:
+        MRF();
+
+      protected:
+
+        //////////////////////////////////////////////////////////////////////////
+        //the number of labeling
+        int no_regions;
+        //potential of Space  Constraint
+        double beta;
+        //terminal condition when (deltaE < t)
+        double t;
+
+        //////////////////////////////////////////////////////////////////////////
+        //for gibbs
+        double T0;
+        //current temperature
+        double T;
+        double c;
+
+        //////////////////////////////////////////////////////////////////////////
+        // alpha value for MMD
+        double alpha;		            
+
+        //////////////////////////////////////////////////////////////////////////
+        //current global energy
+        double E;
+        //old global energy
+        double E_old;
+        //number of iteration
+        int K;
+
+        //////////////////////////////////////////////////////////////////////////
+        // Per pixel fields live in single contiguous buffers of (height+2) rows
+        // of 'stride' elements, with a guard border of one pixel around the
+        // image. Pixel (i,j) is stored at Index(i,j), so the four neighbours are
+        // at -stride, +stride, -1 and +1 without any bounds check.
+        int stride;
+        inline int Index(int i, int j) const { return (i+1)*stride + j + 1; }
+
+        //labeling image, 0/1 inside the image and GUARD_LABEL on the border
+        unsigned char *classes;
+        //input image, swapped with MRF_TC::old_labeling every frame
+        unsigned char *in_image_data;
+        //evidence, (background, foreground) pairs at 2*Index(i,j)
+        float *local_evidence;
+      };
+
+      // Label of the guard pixels. It never equals a real label, so a guard
+      // neighbour adds the same +beta to both labels and cannot change a decision.
+      const unsigned char GUARD_LABEL = 2;
+
+      // Solvers for the labeling, selected with MRFSolver in the T2FMRF config
+      const int MRF_SOLVER_ICM          = 0;
+      const int MRF_SOLVER_CHECKERBOARD = 1;
+      const int MRF_SOLVER_ACTIVE_SET   = 2;
+      const int MRF_SOLVER_GRAPH_CUT    = 3;
+      const int MRF_SOLVER_GIBBS        = 4;
+      const int MRF_SOLVER_METROPOLIS   = 5;
+      const int MRF_SOLVER_PYRAMID      = 6;
+
+      /************************************************************************/
+      /* the Markov Random Field with time constraints for T2FGMM   */
+      /************************************************************************/
+      class MRF_TC: public MRF
+      {
+      private:
+        double beta_time;
+
+      public:
+        IplImage *background2;
+        RgbImage background;
+        unsigned char *old_labeling;
+        //number of GMM modes per pixel in the model given to InitEvidence2
+        int num_modes;
+
+      public:
+        MRF_TC();
+        ~MRF_TC();
+        double TimeEnergy2(int i, int j, int label);
+        void OnIterationOver2(void);
+        void Build_Classes_OldLabeling_InImage_LocalEnergy();
+        // Evidence of a pixel for each label, as -log likelihoods:
+        //   background  |x - mu|^2/(2 var) + 1.5 log(2 pi var), from the
+        //               dominant mode of the pixel, var at least the noise
+        //               floor of the frame (EstimateNoiseFloor)
+        //   foreground  3 log(256), colours uniform over the RGB cube
+        // each plus -log of the HMM transition from the previous label (255
+        // is foreground, any other value background) to the label. This is
+        // the model of this file, not the one of the bgs library MRF_TC.
+        void InitEvidence2(GMM *gmm, const PackedHMM &hmm, IplImage *labeling);
+        // Same, the previous labels are the in_image of the last call (or of
+        // the last PushLabels). The two label buffers swap, nothing is copied.
+        void InitEvidence2(GMM *gmm, const PackedHMM &hmm);
+        // Keep the label history going on frames where the MRF does not run
+        void PushLabels();
+        void CreateOutput2();
+        double CalculateEnergy2();
+        double LocalEnergy2(int i, int j, int label);
+        double Doubleton2(int i, int j, int label);
+
+        void Gibbs2();
+        void ICM2();
+        void Metropolis2(bool mmd);
+        // ICM with red/black half sweeps, rows of each colour split over threads
+        void CheckerboardICM2(int threads = 0);
+        // ICM that only revisits pixels whose neighbourhood changed, the
+        // energy is tracked from the local changes
+        void ActiveSetICM2();
+        // exact minimum of the labeling energy by max-flow/min-cut
+        void GraphCut2();
+        // ICM at 1/4 and 1/2 scale, the result initializes a single full
+        // resolution sweep
+        void PyramidICM2(int levels = 2);
+        // run one of the MRF_SOLVER_* solvers, unknown values run ICM2
+        void Solve(int solver);
+
+        // Threads of the evidence and of the checkerboard solver in Solve,
+        // 0 uses all cores
+        void SetThreads(int n) { threads = n; }
+
+        // Weights of the space (pairs of neighbours) and time (previous
+        // label) constraints, 2.8 and 0.9 by default
+        void SetBeta(double space, double time);
+
+        // Largest difference between LocalEnergy2 (read from the tables) and
+        // the evidence plus Doubleton2 and TimeEnergy2, over all pixels and
+        // labels of the current frame
+        double VerifyEnergyTables();
+
+        // Energy minimized by the solvers, each pair counted once. It differs
+        // from CalculateEnergy2, which counts every pair from both sides, by a
+        // constant factor on the pair terms.
+        double ModelEnergy2();
+
+        // Stop the iterative solvers once a solve has taken 'milliseconds' or
+        // 'iterations' sweeps, 0 is no limit. The budget is checked between
+        // sweeps, so a solve can overrun it by one sweep. ICM keeps the best
+        // labels so far; Gibbs and Metropolis keep their current sample.
+        // GraphCut2 is not interrupted.
+        void SetBudget(double milliseconds, int iterations);
+        // the last solve stopped on the budget instead of converging
+        bool BudgetHit() const { return budget_hit; }
+
+        int Iterations() const { return K; }
+        double Energy() const { return E; }
+        //pixels evaluated by the last ActiveSetICM2
+        long Visits() const { return visits; }
+
+      private:
+        void ReleaseBuffers();
+        void StartBudget();
+        bool OverBudget();
+        void BuildEnergyTables();
+        void ComputeEvidence2(GMM *gmm, const PackedHMM &hmm);
+        void EvidenceRow(int i, GMM *gmm, const float *transition);
+        void EstimateNoiseFloor(GMM *gmm);
+        double ParallelEnergy2(int threads);
+        // band_edge: the rows above or below belong to another thread
+      void CheckerboardRow(int i, int colour, bool band_edge);
+        double FlipEnergy2(int idx, int label, double &global_delta) const;
+        void Activate(int idx);
+
+        //worklists of ActiveSetICM2 (buffer indexes) and their membership flags
+        std::vector<int> active, next_active;
+        unsigned char *queued;
+        long visits;
+
+        // Pair and time energy of a label, indexed by the previous label
+        // (0, 255 or other), the number of neighbours labelled 0 and 1, and
+        // the label: ((time*5 + ones)*5 + zeros)*2 + label. Built from beta
+        // and beta_time by the constructor and SetBeta.
+        double energy_table[3*5*5*2];
+        inline int EnergyKey(int idx) const
+        {
+          // zeros + 5*ones from one table read per neighbour
+          static const int neighbour_key[3] = { 1*2, 5*2, 0 };
+          static const int time_key[3] = { 0, 25*2, 50*2 };
+
+          const unsigned char *n = classes + idx;
+          unsigned char old = old_labeling[idx];
+          int time = (old == 255) + 2*(old != 0 && old != 255);
+
+          return time_key[time] + neighbour_key[n[-stride]] + neighbour_key[n[stride]]
+               + neighbour_key[n[-1]] + neighbour_key[n[1]];
+        }
+
+        int threads;
+
+        // Lower bound of the mode variances in the evidence, a quarter of the
+        // noise variance measured on the background labels of the frame
+        float noise_floor;
+        std::vector<float> noise_samples;
+
+        double time_budget;
+        int iteration_budget;
+        bool budget_hit;
+        std::chrono::steady_clock::time_point solve_start;
+
+        //graph of GraphCut2, kept between frames
+        GridGraphCut graph;
+
+        // Coarse level of PyramidICM2, half the size of the level below. The
+        // evidence of a pixel is the sum of the energies of the 2x2 block it
+        // covers, time term included.
+        struct PyramidLevel
+        {
+          int width, height, stride;
+          std::vector<float> evidence;
+          std::vector<unsigned char> labels;
+          std::vector<int> ones, count;   // BuildPyramid's block votes
+          inline int Index(int i, int j) const { return (i+1)*stride + j + 1; }
+        };
+        std::vector<PyramidLevel> pyramid;
+
+        void BuildPyramid(int levels);
+        int SweepLevel(PyramidLevel &level, double level_beta);
+      };
+    }
   }
 }
 
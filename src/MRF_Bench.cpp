@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+
+#include "T2FMRF.h"
+#include "MRF.h"
+#include "FrameReaderFactory.h"
+
+using namespace cv;
+using namespace std;
+using namespace seq;
+using namespace Algorithms::BackgroundSubtraction;
+using namespace Algorithms::BackgroundSubtraction::BgsClient;
+
+const char* keys =
+{
+    "{ f | input     |       | Input video }"
+    "{ n | frames    | 100   | Number of frames to process }"
+    "{ b | beta      | 2.8   | Weight of the space constraint }"
+    "{ e | time      | 0.9   | Weight of the time constraint }"
+    "{ v | verify    | false | Check the energy tables against the direct terms on every frame }"
+    "{ h | help      | false | Print help message }"
+};
+
+void display_message()
+{
+    cout << "MRF solver benchmark for T2FMRF.                            " << endl;
+    cout << "------------------------------------------------------------" << endl;
+    cout << "Runs every MRF solver on the same evidence of each frame and " << endl;
+    cout << "reports the energy reached, the time per frame and the share " << endl;
+    cout << "of pixels labelled differently from ICM.                     " << endl;
+    cout << "Example:                                                    " << endl;
+    cout << "mrf_bench -f movie_file -n 200                              " << endl << endl;
+    cout << "------------------------------------------------------------" << endl <<endl;
+}
+
+// Frames used by T2FMRF_UMBuilder to warm up the model before the MRF runs
+const int WARMUP_FRAMES = 10;
+
+struct Solver
+{
+    const char* name;
+    int id;
+    double energy;
+    double milliseconds;
+    long iterations;
+    long differences;       // pixels labelled differently from ICM
+};
+
+
+int main( int argc, char** argv )
+{
+    //Parse console parameters
+    CommandLineParser cmd(argc, argv, keys);
+
+    const string inputName = cmd.get<string>("input");
+    const int    maxFrames = cmd.get<int>("frames");
+    const double beta      = cmd.get<double>("beta");
+    const double betaTime  = cmd.get<double>("time");
+    const bool   verify    = cmd.get<bool>("verify");
+
+    if (cmd.get<bool>("help")) {
+        display_message();
+        cmd.printParams();
+        return 0;
+    }
+
+    FrameReader *input_frame;
+    try {
+        input_frame = FrameReaderFactory::create_frame_reader(inputName);
+    } catch (...) {
+        cout << "Invalid file name "<< endl;
+        return 0;
+    }
+
+    int cols = input_frame->getNumberCols();
+    int rows = input_frame->getNumberRows();
+
+    // Same defaults as T2FMRF_UMBuilder
+    T2FMRFParams params;
+    params.SetFrameSize(cols, rows);
+    params.LowThreshold()  = 9.f;
+    params.HighThreshold() = 2*params.LowThreshold();
+    params.Alpha()         = 0.001f;
+    params.MaxModes()      = 3;
+    params.Type()          = TYPE_T2FMRF_UM;
+    params.KM()            = 1.5f;
+    params.KV()            = 0.6f;
+
+    T2FMRF model;
+    model.Initalize(params);
+    RgbImage dummy = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    model.InitModel(dummy);
+
+    BwImage lowThresholdMask  = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    BwImage highThresholdMask = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    IplImage* previous_saved  = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    IplImage* labels          = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    IplImage* icm_labels      = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
+    cvZero(previous_saved);
+
+    MRF_TC mrf;
+    mrf.width     = cols;
+    mrf.height    = rows;
+    mrf.num_modes = params.MaxModes();
+    mrf.Build_Classes_OldLabeling_InImage_LocalEnergy();
+    mrf.SetBeta(beta, betaTime);
+
+    Solver solvers[] = {
+        { "ICM",          MRF_SOLVER_ICM,          0, 0, 0, 0 },
+        { "Gibbs",        MRF_SOLVER_GIBBS,        0, 0, 0, 0 },
+        { "Metropolis",   MRF_SOLVER_METROPOLIS,   0, 0, 0, 0 },
+        { "Checkerboard", MRF_SOLVER_CHECKERBOARD, 0, 0, 0, 0 },
+        { "ActiveSet",    MRF_SOLVER_ACTIVE_SET,   0, 0, 0, 0 },
+        { "GraphCut",     MRF_SOLVER_GRAPH_CUT,    0, 0, 0, 0 },
+        { "Pyramid",      MRF_SOLVER_PYRAMID,      0, 0, 0, 0 },
+    };
+    const int nsolvers = sizeof(solvers)/sizeof(solvers[0]);
+
+    Mat CurrentFrame;
+    int cnt = 0;
+    int measured = 0;
+    double tableError = 0.;
+
+    for (; cnt < maxFrames; ++cnt)
+    {
+        input_frame->getFrame(CurrentFrame);
+        if (CurrentFrame.empty()) break;
+
+        IplImage ipl_frame = CurrentFrame;
+        RgbImage model_frame(&ipl_frame);
+        model_frame.ReleaseMemory(false);
+
+        model.Subtract(cnt, model_frame, lowThresholdMask, highThresholdMask);
+
+        if (cnt >= WARMUP_FRAMES)
+        {
+            mrf.background2 = model_frame.Ptr();
+            mrf.in_image    = lowThresholdMask.Ptr();
+            mrf.out_image   = labels;
+
+            // every solver starts from the same labels and evidence
+            for (int s = 0; s < nsolvers; ++s) {
+                mrf.InitEvidence2(model.gmm(), model.hmm(), previous_saved);
+
+                // the tables and the direct energy terms differ only by rounding
+                if (verify && s == 0)
+                    tableError = std::max(tableError, mrf.VerifyEnergyTables());
+
+                std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+                mrf.Solve(solvers[s].id);
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+                solvers[s].milliseconds += std::chrono::duration<double, std::milli>(end - begin).count();
+                solvers[s].energy       += mrf.ModelEnergy2();
+                solvers[s].iterations   += mrf.Iterations();
+
+                // ICM runs first, every solver is compared with its labels
+                if (s == 0)
+                    cvCopy(labels, icm_labels);
+                solvers[s].differences += countNonZero(Mat(labels) != Mat(icm_labels));
+            }
+            ++measured;
+        }
+
+        cvCopy(lowThresholdMask.Ptr(), previous_saved);
+    }
+
+    cout << "# frames=" << measured << " size=" << cols << "x" << rows
+         << " beta=" << beta << " time=" << betaTime << endl;
+    if (verify)
+        cout << "# energy tables max error=" << tableError
+             << (tableError < 1e-9 ? " ok" : " MISMATCH") << endl;
+    cout << "# solver        energy/frame      ms/frame  iterations/frame  differ from ICM %" << endl;
+    for (int s = 0; s < nsolvers && measured > 0; ++s) {
+        cout << left  << setw(14) << solvers[s].name
+             << right << setw(14) << fixed << setprecision(1) << solvers[s].energy/measured
+             << setw(14) << setprecision(3) << solvers[s].milliseconds/measured
+             << setw(18) << setprecision(2) << (double)solvers[s].iterations/measured
+             << setw(19) << setprecision(3) << 100.*solvers[s].differences/((double)measured*cols*rows)
+             << endl;
+    }
+
+    cvReleaseImage(&previous_saved);
+    cvReleaseImage(&labels);
+    cvReleaseImage(&icm_labels);
+    delete input_frame;
+
+    return 0;
+}
@@ -0,0 +1,415 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "MaskArchive.h"
+
+
+void pack_mask_bits(const Mat& mask, unsigned char* bits)
+{
+    size_t bytes = ((size_t)mask.cols*mask.rows + 7)/8;
+    memset(bits, 0, bytes);
+
+    if (mask.isContinuous()) {
+        const unsigned char* src = mask.ptr<unsigned char>(0);
+        size_t total = (size_t)mask.cols*mask.rows;
+        size_t n = 0;
+
+#ifdef __SSE2__
+        // the sign bit of each byte is exactly "pixel > 127"
+        for (; n + 16 <= total; n += 16) {
+            int m = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(src + n)));
+            bits[(n >> 3)]     = (unsigned char)m;
+            bits[(n >> 3) + 1] = (unsigned char)(m >> 8);
+        }
+#endif
+        for (; n < total; ++n)
+            bits[n >> 3] |= (unsigned char)((src[n] > 127) << (n & 7));
+        return;
+    }
+
+    size_t n = 0;
+    for (int r = 0; r < mask.rows; ++r) {
+        const unsigned char* row = mask.ptr<unsigned char>(r);
+        for (int c = 0; c < mask.cols; ++c, ++n)
+            bits[n >> 3] |= (unsigned char)((row[c] > 127) << (n & 7));
+    }
+}
+
+void unpack_mask_bits(const unsigned char* bits, Mat& mask)
+{
+    if (mask.isContinuous()) {
+        unsigned char* dst = mask.ptr<unsigned char>(0);
+        size_t total = (size_t)mask.cols*mask.rows;
+        size_t n = 0;
+
+#ifdef __SSE2__
+        // spread two bytes of bits over 16 lanes and test one bit per lane
+        const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128,
+                                             1, 2, 4, 8, 16, 32, 64, -128);
+        for (; n + 16 <= total; n += 16) {
+            int m = bits[n >> 3] | (bits[(n >> 3) + 1] << 8);
+            __m128i v = _mm_cvtsi32_si128(m);
+            v = _mm_unpacklo_epi8(v, v);
+            v = _mm_unpacklo_epi16(v, v);
+            v = _mm_unpacklo_epi32(v, v);
+            v = _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+            _mm_storeu_si128((__m128i*)(dst + n), v);
+        }
+#endif
+        for (; n < total; ++n)
+            dst[n] = ((bits[n >> 3] >> (n & 7)) & 1) ? 255 : 0;
+        return;
+    }
+
+    size_t n = 0;
+    for (int r = 0; r < mask.rows; ++r) {
+        unsigned char* row = mask.ptr<unsigned char>(r);
+        for (int c = 0; c < mask.cols; ++c, ++n)
+            row[c] = ((bits[n >> 3] >> (n & 7)) & 1) ? 255 : 0;
+    }
+}
+
+bool mask_encoding_from_name(const string& name, uint32_t& encoding, int& keyframes)
+{
+    keyframes = 1;
+
+    if (name == "bits")
+        encoding = MASK_ENCODING_BITS;
+    else if (name == "rle")
+        encoding = MASK_ENCODING_RLE;
+    else if (name == "delta") {
+        encoding  = MASK_ENCODING_RLE;
+        keyframes = MASK_KEYFRAME_INTERVAL;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+
+MaskArchiveWriter::MaskArchiveWriter()
+{
+    file = NULL;
+    offset = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+MaskArchiveWriter::~MaskArchiveWriter()
+{
+    Close();
+}
+
+bool MaskArchiveWriter::Open(const string& filename, int cols, int rows,
+                             uint32_t encoding, int keyframes)
+{
+    Close();
+
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MASK_ARCHIVE_MAGIC, 4);
+    header.version   = MASK_ARCHIVE_VERSION;
+    header.cols      = cols;
+    header.rows      = rows;
+    header.encoding  = encoding;
+    header.keyframes = (encoding == MASK_ENCODING_RLE && keyframes > 1) ? keyframes : 1;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+    offset = sizeof(header);
+
+    size_t words = mask_words((size_t)cols*rows);
+    index.clear();
+    bits.assign(words, 0);
+    previous.assign(words, 0);
+    payload.clear();
+
+    return true;
+}
+
+bool MaskArchiveWriter::Write(int frame, const Mat& mask)
+{
+    if (file == NULL || mask.type() != CV_8UC1 ||
+        mask.cols != (int)header.cols || mask.rows != (int)header.rows)
+        return false;
+
+    size_t n = (size_t)header.cols*header.rows;
+    pack_mask_bits(mask, (unsigned char*)&bits[0]);
+
+    const unsigned char* data = (const unsigned char*)&bits[0];
+    size_t size = (n + 7)/8;
+
+    if (header.encoding == MASK_ENCODING_RLE) {
+        if (index.size() % header.keyframes == 0)
+            mask_rle_encode(&bits[0], n, payload);
+        else {
+            // previous becomes the change against the last frame
+            mask_xor_bits(&previous[0], &bits[0], bits.size());
+            mask_rle_encode(&previous[0], n, payload);
+        }
+        previous.swap(bits);
+
+        data = &payload[0];
+        size = payload.size();
+    }
+
+    MaskFrameHeader record;
+    record.frame = frame;
+    record.size  = size;
+
+    // after a short write the deltas no longer follow the stored frames:
+    // drop the partial record and finish the archive with the frames
+    // written in full
+    if (fwrite(&record, sizeof(record), 1, file) != 1 ||
+        fwrite(data, 1, size, file) != size) {
+        fflush(file);
+        if (ftruncate(fileno(file), offset) == 0 && fseek(file, offset, SEEK_SET) == 0)
+            Close();
+        else {
+            fclose(file);
+            file = NULL;
+        }
+        return false;
+    }
+
+    MaskIndexEntry entry;
+    entry.offset = offset;
+    entry.frame  = frame;
+    entry.size   = size;
+    index.push_back(entry);
+
+    offset += sizeof(record) + size;
+
+    return true;
+}
+
+bool MaskArchiveWriter::Close()
+{
+    if (file == NULL)
+        return true;
+
+    MaskArchiveFooter footer;
+    memcpy(footer.magic, MASK_INDEX_MAGIC, 4);
+    footer.count        = index.size();
+    footer.index_offset = offset;
+
+    bool ok = true;
+    if (!index.empty())
+        ok = fwrite(&index[0], sizeof(MaskIndexEntry), index.size(), file) == index.size();
+    ok = ok && fwrite(&footer, sizeof(footer), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+    file = NULL;
+
+    return ok;
+}
+
+
+MaskArchiveReader::MaskArchiveReader()
+{
+    data = NULL;
+    length = 0;
+    decoded = -1;
+    memset(&header, 0, sizeof(header));
+}
+
+MaskArchiveReader::~MaskArchiveReader()
+{
+    Close();
+}
+
+bool MaskArchiveReader::Open(const string& filename)
+{
+    Close();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MaskArchiveHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    data   = (unsigned char*)map;
+    length = st.st_size;
+
+    // frames are read front to back
+    madvise(data, length, MADV_SEQUENTIAL);
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MASK_ARCHIVE_MAGIC, 4) != 0 ||
+        header.version != MASK_ARCHIVE_VERSION) {
+        Close();
+        return false;
+    }
+
+    if (header.keyframes < 1)
+        header.keyframes = 1;
+
+    uint64_t end = length;
+    if (!ReadIndex(end))
+        ScanFrames(end);
+
+    size_t words = mask_words((size_t)header.cols*header.rows);
+    bits.assign(words, 0);
+    delta.assign(words, 0);
+    decoded = -1;
+
+    return true;
+}
+
+void MaskArchiveReader::Close()
+{
+    if (data != NULL)
+        munmap(data, length);
+
+    data = NULL;
+    length = 0;
+    decoded = -1;
+    index.clear();
+}
+
+bool MaskArchiveReader::ReadIndex(uint64_t& end)
+{
+    if (length < sizeof(MaskArchiveHeader) + sizeof(MaskArchiveFooter))
+        return false;
+
+    MaskArchiveFooter footer;
+    memcpy(&footer, data + length - sizeof(footer), sizeof(footer));
+
+    uint64_t index_end = length - sizeof(footer);
+    if (memcmp(footer.magic, MASK_INDEX_MAGIC, 4) != 0 ||
+        footer.index_offset < sizeof(MaskArchiveHeader) || footer.index_offset > index_end)
+        return false;
+
+    // the frames end where the index starts, even if the index is damaged
+    end = footer.index_offset;
+    if ((index_end - footer.index_offset)/sizeof(MaskIndexEntry) != footer.count ||
+        (index_end - footer.index_offset)%sizeof(MaskIndexEntry) != 0)
+        return false;
+
+    index.resize(footer.count);
+    if (footer.count > 0)
+        memcpy(&index[0], data + footer.index_offset, footer.count*sizeof(MaskIndexEntry));
+
+    // every frame must lie between the header and the index, otherwise
+    // the frames are found by walking them
+    for (size_t k = 0; k < index.size(); ++k) {
+        if (index[k].offset < sizeof(MaskArchiveHeader) ||
+            index[k].offset > footer.index_offset ||
+            footer.index_offset - index[k].offset < sizeof(MaskFrameHeader) + (uint64_t)index[k].size) {
+            index.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MaskArchiveReader::ScanFrames(uint64_t end)
+{
+    // no index, the writer stopped early: keep every complete frame
+    uint64_t offset = sizeof(MaskArchiveHeader);
+
+    while (offset + sizeof(MaskFrameHeader) <= end) {
+        MaskFrameHeader record;
+        memcpy(&record, data + offset, sizeof(record));
+
+        if (offset + sizeof(record) + record.size > end)
+            break;
+
+        MaskIndexEntry entry;
+        entry.offset = offset;
+        entry.frame  = record.frame;
+        entry.size   = record.size;
+        index.push_back(entry);
+
+        offset += sizeof(record) + record.size;
+    }
+}
+
+const unsigned char* MaskArchiveReader::Payload(int k) const
+{
+    return data + index[k].offset + sizeof(MaskFrameHeader);
+}
+
+bool MaskArchiveReader::DecodeBits(int k)
+{
+    if (decoded == k)
+        return true;
+
+    size_t n = (size_t)header.cols*header.rows;
+    int key = k - k % header.keyframes;
+
+    // continue from the last decoded frame when it is on the way
+    int j = (decoded >= key && decoded < k) ? decoded + 1 : key;
+
+    for (; j <= k; ++j) {
+        uint64_t* out = (j == key) ? &bits[0] : &delta[0];
+        if (!mask_rle_decode(Payload(j), index[j].size, out, n)) {
+            decoded = -1;
+            return false;
+        }
+        if (j != key)
+            mask_xor_bits(&bits[0], &delta[0], bits.size());
+        decoded = j;
+    }
+
+    return true;
+}
+
+bool MaskArchiveReader::Read(int k, Mat& mask)
+{
+    if (data == NULL || k < 0 || k >= (int)index.size())
+        return false;
+
+    mask.create(header.rows, header.cols, CV_8UC1);
+
+    if (header.encoding == MASK_ENCODING_BITS) {
+        if (index[k].size != ((size_t)header.cols*header.rows + 7)/8)
+            return false;
+        unpack_mask_bits(Payload(k), mask);
+        return true;
+    }
+
+    if (header.encoding != MASK_ENCODING_RLE || !DecodeBits(k))
+        return false;
+
+    unpack_mask_bits((const unsigned char*)&bits[0], mask);
+    return true;
+}
@@ -0,0 +1,180 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _MASK_ARCHIVE_H
+#define _MASK_ARCHIVE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "MaskRLE.h"
+
+using namespace cv;
+using std::string;
+
+
+/*
+ * Single file with all the foreground masks of a sequence, written once
+ * front to back and read through mmap. Layout (little endian):
+ *
+ *   MaskArchiveHeader
+ *   for each frame: MaskFrameHeader + payload
+ *   MaskIndexEntry[count]
+ *   MaskArchiveFooter
+ *
+ * The index and footer are written by Close(). An archive without them
+ * (the writer did not finish) is still readable by walking the frames.
+ *
+ * With a keyframe interval k > 1 every k-th stored frame is a keyframe and
+ * the frames between hold the XOR against the previous frame, so reading
+ * a frame decodes forward from the keyframe before it.
+ */
+const char     MASK_ARCHIVE_MAGIC[4] = { 'B', 'G', 'S', 'M' };
+const char     MASK_INDEX_MAGIC[4]   = { 'B', 'G', 'S', 'I' };
+const uint32_t MASK_ARCHIVE_VERSION  = 1;
+
+// Payload encodings of the bit packed mask (row order, lowest bit first)
+const uint32_t MASK_ENCODING_BITS = 0;     // raw bits
+const uint32_t MASK_ENCODING_RLE  = 1;     // run lengths, see MaskRLE.h
+
+// Keyframe interval of the delta output
+const int MASK_KEYFRAME_INTERVAL = 50;
+
+struct MaskArchiveHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t encoding;
+    uint32_t keyframes;     // keyframe interval, 0 or 1 without deltas
+    uint32_t reserved[2];
+};
+
+struct MaskFrameHeader
+{
+    uint32_t frame;     // frame number in the sequence
+    uint32_t size;      // payload bytes that follow
+};
+
+struct MaskIndexEntry
+{
+    uint64_t offset;    // of the MaskFrameHeader
+    uint32_t frame;
+    uint32_t size;
+};
+
+struct MaskArchiveFooter
+{
+    char     magic[4];
+    uint32_t count;
+    uint64_t index_offset;
+};
+
+
+class MaskArchiveWriter
+{
+
+public:
+
+    MaskArchiveWriter();
+    ~MaskArchiveWriter();
+
+    // Create (truncate) the archive for masks of cols x rows, deltas
+    // against the previous frame are only used with MASK_ENCODING_RLE
+    bool Open(const string& filename, int cols, int rows,
+              uint32_t encoding = MASK_ENCODING_BITS, int keyframes = 1);
+    // Append the mask of a frame, pixels > 127 are foreground. If the
+    // file cannot be written the archive is closed with the frames before.
+    bool Write(int frame, const Mat& mask);
+    // Write the index and footer, called by the destructor when open.
+    // False if the file could not be written.
+    bool Close();
+
+    bool IsOpen() const { return file != NULL; };
+
+private:
+
+    FILE* file;
+    MaskArchiveHeader header;
+    std::vector<MaskIndexEntry> index;
+    std::vector<unsigned char> payload;
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> previous;
+    uint64_t offset;
+
+};
+
+
+class MaskArchiveReader
+{
+
+public:
+
+    MaskArchiveReader();
+    ~MaskArchiveReader();
+
+    bool Open(const string& filename);
+    void Close();
+
+    int Cols() const { return header.cols; };
+    int Rows() const { return header.rows; };
+    int Encoding() const { return header.encoding; };
+    int Frames() const { return (int)index.size(); };
+    int FrameNumber(int k) const { return index[k].frame; };
+
+    // Decode the k-th stored mask as CV_8UC1 with values 0 and 255,
+    // false if k is not in [0, Frames()) or its payload is corrupt
+    bool Read(int k, Mat& mask);
+
+private:
+
+    const unsigned char* Payload(int k) const;
+    // index of the footer, false if missing or damaged; end is where
+    // the frames stop, the index offset when the footer is intact
+    bool ReadIndex(uint64_t& end);
+    // frames walked from the header up to end
+    void ScanFrames(uint64_t end);
+    bool DecodeBits(int k);
+
+    unsigned char* data;
+    size_t length;
+    MaskArchiveHeader header;
+    std::vector<MaskIndexEntry> index;
+
+    // last decoded frame, reading forward only decodes the next delta
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> delta;
+    int decoded;
+
+};
+
+
+// Bit packing of a CV_8UC1 mask, shared with the encoders. bits holds
+// (cols*rows + 7)/8 bytes, the unused bits of the last byte are zero.
+void pack_mask_bits(const Mat& mask, unsigned char* bits);
+void unpack_mask_bits(const unsigned char* bits, Mat& mask);
+
+// Encoding named on the command line: "bits", "rle" or "delta" (rle with
+// keyframes). False for any other name, e.g. "png".
+bool mask_encoding_from_name(const string& name, uint32_t& encoding, int& keyframes);
+
+
+#endif
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <vector>
+#include <sstream>
+
+#include "MaskArchive.h"
+#include "GroundTruthEvaluator.h"
+
+using namespace cv;
+using namespace std;
+using namespace boost::filesystem;
+
+
+const char* keys =
+{
+    "{ i | input       |       | Mask archive, or a mask directory with masks.bgsm }"
+    "{ e | export      |       | Write the masks as <dir>/<frame>.png, as the drivers do without -o }"
+    "{ g | groundtruth |       | Score the masks against the ground-truth images of this directory }"
+    "{ s | scores      | masks_scores.txt | Per frame scores of -g }"
+    "{ h | help        | false | Print help message }"
+};
+
+void display_message()
+{
+    cout << "Masks of a .bgsm archive.                                   " << endl;
+    cout << "------------------------------------------------------------" << endl;
+    cout << "Reads the archive written by bgs_imbs, t2fgmm and t2fmrf    " << endl;
+    cout << "with -o bits, rle or delta. Exports the masks to png files  " << endl;
+    cout << "for pmbgs, or scores them against the ground truth.         " << endl;
+    cout << "OpenCV Version : "  << CV_VERSION << endl;
+    cout << "Example:                                                    " << endl;
+    cout << "bgs_masks -i imbs_mask/0 -e imbs_mask/0                     " << endl;
+    cout << "bgs_masks -i imbs_mask/0/masks.bgsm -g GT/KickPerson1Camera3" << endl << endl;
+    cout << "------------------------------------------------------------" << endl <<endl;
+}
+
+
+int main( int argc, char** argv )
+{
+    //Parse console parameters
+    CommandLineParser cmd(argc, argv, keys);
+
+    // Reading input parameters
+    string inputName                      = cmd.get<string>("input");
+    const string exportPath               = cmd.get<string>("export");
+    const string groundTruth              = cmd.get<string>("groundtruth");
+    const string scoresFile               = cmd.get<string>("scores");
+
+    // Show help not input options
+    if (cmd.get<bool>("help") || inputName.empty() ||
+        (exportPath.empty() && groundTruth.empty())) {
+        display_message();
+        cmd.printParams();
+        return 0;
+    }
+
+    if (is_directory(inputName))
+        inputName = (path(inputName) / "masks.bgsm").string();
+
+    MaskArchiveReader archive;
+    if (!archive.Open(inputName)) {
+        cout << "Invalid mask archive " << inputName << endl;
+        return 0;
+    }
+
+    if (archive.Frames() == 0) {
+        cout << "No masks in " << inputName << endl;
+        return 0;
+    }
+
+    if (!exportPath.empty())
+        create_directories(exportPath);
+
+    // The archive holds the frames of the range in increasing order
+    GroundTruthEvaluator evaluator;
+    if (!groundTruth.empty() &&
+        !evaluator.Open(groundTruth, archive.FrameNumber(0),
+                        archive.FrameNumber(archive.Frames() - 1)))
+        cout << "No ground-truth images in " << groundTruth << endl;
+
+    vector<int> compression_params;
+    compression_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    compression_params.push_back(9);
+
+    Mat Foreground;
+    int corrupt = 0;
+
+    for (int k = 0; k < archive.Frames(); ++k) {
+
+        if (!archive.Read(k, Foreground)) {
+            corrupt += 1;
+            continue;
+        }
+
+        int frame = archive.FrameNumber(k);
+
+        if (evaluator.IsOpen())
+            evaluator.Evaluate(frame, Foreground);
+
+        if (!exportPath.empty()) {
+            stringstream str;
+            str << exportPath << "/" << frame << ".png";
+            if (!imwrite(str.str(), Foreground, compression_params))
+                cout << "Could not write " << str.str() << endl;
+        }
+    }
+
+    cout << "Read " << archive.Frames() - corrupt << " of " << archive.Frames()
+         << " masks of " << archive.Cols() << "x" << archive.Rows() << endl;
+
+    if (evaluator.IsOpen()) {
+        FrameScore total = evaluator.Total();
+        cout << "Scored " << total.frame << " frames: "
+             << "precision " << total.Precision() << " "
+             << "recall "    << total.Recall()    << " "
+             << "fmeasure "  << total.FMeasure()  << endl;
+        evaluator.WriteSummary(scoresFile, inputName);
+        evaluator.Close();
+    }
+
+    return 0;
+}
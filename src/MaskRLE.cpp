@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <string.h>
+
+#include "MaskRLE.h"
+
+
+static inline void put_varint(std::vector<unsigned char>& out, size_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+static inline bool get_varint(const unsigned char*& in, const unsigned char* end, size_t& v)
+{
+    v = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        unsigned char b = *in++;
+        v |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Set bits [begin, end)
+static void set_bit_range(uint64_t* bits, size_t begin, size_t end)
+{
+    if (begin >= end)
+        return;
+
+    size_t first = begin >> 6;
+    size_t last  = (end - 1) >> 6;
+    uint64_t head = ~0ULL << (begin & 63);
+    uint64_t tail = ~0ULL >> (63 - ((end - 1) & 63));
+
+    if (first == last) {
+        bits[first] |= head & tail;
+        return;
+    }
+
+    bits[first] |= head;
+    for (size_t w = first + 1; w < last; ++w)
+        bits[w] = ~0ULL;
+    bits[last] |= tail;
+}
+
+
+void mask_rle_encode(const uint64_t* bits, size_t n, std::vector<unsigned char>& out)
+{
+    out.clear();
+
+    // Masks are mostly long runs: whole words equal to the current value
+    // are skipped, the next transition inside a word is found with ctz.
+    size_t words = mask_words(n);
+    size_t start = 0;
+    size_t pos   = 0;
+    uint64_t value = 0;
+
+    for (size_t w = 0; w < words; ) {
+        uint64_t x = (bits[w] ^ value) & (~0ULL << (pos & 63));
+        if (x == 0) {
+            pos = ++w << 6;
+            continue;
+        }
+
+        size_t t = (w << 6) + __builtin_ctzll(x);
+        if (t >= n)
+            break;
+
+        put_varint(out, t - start);
+        start = pos = t;
+        value = ~value;
+    }
+
+    put_varint(out, n - start);
+}
+
+bool mask_rle_decode(const unsigned char* in, size_t size, uint64_t* bits, size_t n)
+{
+    memset(bits, 0, mask_words(n)*sizeof(uint64_t));
+
+    const unsigned char* end = in + size;
+    size_t pos = 0;
+    bool one = false;
+
+    while (in < end) {
+        size_t run;
+        if (!get_varint(in, end, run) || run > n - pos)
+            return false;
+
+        if (one)
+            set_bit_range(bits, pos, pos + run);
+
+        pos += run;
+        one = !one;
+    }
+
+    return pos == n;
+}
+
+void mask_xor_bits(uint64_t* a, const uint64_t* b, size_t words)
+{
+    for (size_t w = 0; w < words; ++w)
+        a[w] ^= b[w];
+}
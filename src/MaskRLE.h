@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _MASK_RLE_H
+#define _MASK_RLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Run length coding of a bit packed mask. A mask of n pixels is stored as
+ * one bit per pixel, lowest bit first, in 64 bit words (see pack_mask_bits).
+ * The encoded stream is the list of run lengths, alternating background
+ * and foreground and starting with background (the first run may be 0),
+ * each one written as a LEB128 varint. The runs add up to n.
+ *
+ * Temporal deltas are the same encoding applied to the XOR of two masks.
+ */
+
+// Number of 64 bit words holding n bits
+inline size_t mask_words(size_t n) { return (n + 63)/64; }
+
+// Encode the n bits in bits, bits past n must be zero
+void mask_rle_encode(const uint64_t* bits, size_t n, std::vector<unsigned char>& out);
+
+// Decode size bytes into n bits, false if the stream does not add up to n
+bool mask_rle_decode(const unsigned char* in, size_t size, uint64_t* bits, size_t n);
+
+// a ^= b over words
+void mask_xor_bits(uint64_t* a, const uint64_t* b, size_t words);
+
+#endif
@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+
+#include "MaskStream.h"
+#include "MaskArchive.h"
+#include "MaskRLE.h"
+
+
+bool mask_stream_encoding_from_name(const string& name, uint32_t& encoding)
+{
+    if (name == "raw")
+        encoding = MASK_STREAM_RAW;
+    else if (name == "rle")
+        encoding = MASK_STREAM_RLE;
+    else
+        return false;
+
+    return true;
+}
+
+
+MaskStream::MaskStream()
+{
+    fd = -1;
+    owns_fd = false;
+    encoding = MASK_STREAM_RAW;
+}
+
+MaskStream::~MaskStream()
+{
+    Close();
+}
+
+bool MaskStream::Open(const string& path, uint32_t _encoding)
+{
+    Close();
+
+    // a reader that goes away must give EPIPE, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    encoding = _encoding;
+
+    if (path == "stdout") {
+        fd = STDOUT_FILENO;
+        owns_fd = false;
+        return true;
+    }
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 && mkfifo(path.c_str(), 0644) != 0)
+        return false;
+
+    // an existing regular file is rewritten from the start, O_TRUNC has no
+    // effect on a pipe
+    fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    owns_fd = true;
+
+    return fd >= 0;
+}
+
+void MaskStream::Close()
+{
+    if (fd >= 0 && owns_fd)
+        close(fd);
+
+    fd = -1;
+    owns_fd = false;
+}
+
+bool MaskStream::WriteAll(const void* data, size_t size)
+{
+    // writes to a pipe larger than its buffer may be split
+    const char* p = (const char*)data;
+
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p    += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+bool MaskStream::Write(int frame, const Mat& mask)
+{
+    if (fd < 0 || mask.type() != CV_8UC1)
+        return false;
+
+    size_t n = (size_t)mask.cols*mask.rows;
+    const unsigned char* data;
+    size_t size;
+    Mat continuous;
+
+    if (encoding == MASK_STREAM_RLE) {
+        bits.assign(mask_words(n), 0);
+        pack_mask_bits(mask, (unsigned char*)&bits[0]);
+        mask_rle_encode(&bits[0], n, payload);
+        data = &payload[0];
+        size = payload.size();
+    }
+    else {
+        continuous = mask.isContinuous() ? mask : mask.clone();
+        data = continuous.ptr<unsigned char>(0);
+        size = n;
+    }
+
+    MaskStreamHeader header;
+    memcpy(header.magic, MASK_STREAM_MAGIC, 4);
+    header.frame     = frame;
+    header.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch()).count();
+    header.cols      = mask.cols;
+    header.rows      = mask.rows;
+    header.encoding  = encoding;
+    header.size      = size;
+
+    if (!WriteAll(&header, sizeof(header)) || !WriteAll(data, size)) {
+        Close();
+        return false;
+    }
+
+    return true;
+}
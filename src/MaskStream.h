@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _MASK_STREAM_H
+#define _MASK_STREAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using std::string;
+
+
+/*
+ * Masks written to stdout or a named pipe for another process. Each frame
+ * is a MaskStreamHeader followed by size bytes of payload:
+ *
+ *   MASK_STREAM_RAW  one byte per pixel, row order, as given to Write()
+ *   MASK_STREAM_RLE  run lengths of the mask bits (see MaskRLE.h)
+ *
+ * All fields are little endian.
+ */
+const char     MASK_STREAM_MAGIC[4] = { 'B', 'G', 'S', 'F' };
+const uint32_t MASK_STREAM_RAW = 0;
+const uint32_t MASK_STREAM_RLE = 1;
+
+struct MaskStreamHeader
+{
+    char     magic[4];
+    uint32_t frame;
+    uint64_t timestamp;     // microseconds since the epoch
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t encoding;
+    uint32_t size;          // payload bytes that follow
+};
+
+
+class MaskStream
+{
+
+public:
+
+    MaskStream();
+    ~MaskStream();
+
+    // "stdout" or a path, created as a named pipe when it does not exist.
+    // Opening a pipe waits for a reader, an existing file is truncated.
+    bool Open(const string& path, uint32_t encoding);
+    // Send the mask of a frame, false (and closed) once the reader is gone
+    bool Write(int frame, const Mat& mask);
+    void Close();
+
+    bool IsOpen() const { return fd >= 0; };
+
+private:
+
+    bool WriteAll(const void* data, size_t size);
+
+    int fd;
+    bool owns_fd;
+    uint32_t encoding;
+    std::vector<uint64_t> bits;
+    std::vector<unsigned char> payload;
+
+};
+
+
+// Encoding named on the command line: "raw" or "rle"
+bool mask_stream_encoding_from_name(const string& name, uint32_t& encoding);
+
+
+#endif
@@ -0,0 +1,56 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _PARALLEL_ROWS_H
+#define _PARALLEL_ROWS_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Split rows [0, rows) into contiguous bands and call body(first, last) for
+ * each band, one band per thread. The calling thread takes the first band.
+ * threads <= 0 uses all hardware threads.
+ */
+template <typename Body>
+void parallel_rows(int rows, Body body, int threads = 0)
+{
+    if (threads <= 0)
+        threads = std::thread::hardware_concurrency();
+    threads = std::max(1, std::min(threads, rows));
+
+    if (threads == 1) {
+        body(0, rows);
+        return;
+    }
+
+    int band = (rows + threads - 1) / threads;
+
+    std::vector<std::thread> t;
+    for (int first = band; first < rows; first += band)
+        t.push_back(std::thread(body, first, std::min(rows, first + band)));
+
+    body(0, std::min(rows, band));
+
+    for (auto &e : t)
+        e.join();
+}
+
+
+#endif
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <fstream>
+#include <sstream>
+
+#include "ParameterSweep.h"
+
+
+static const string XML_HEADER_TAG = "opencv_storage";
+
+
+bool ParameterSweep::Load(const string& filename)
+{
+    configs.clear();
+
+    std::ifstream in(filename.c_str());
+    if (!in.is_open())
+        return false;
+
+    string line;
+    while (std::getline(in, line)) {
+        std::stringstream items(line);
+        string item;
+
+        // values of each parameter of the line
+        std::vector<std::pair<string, std::vector<string> > > values;
+        while (items >> item) {
+            if (values.empty() && item[0] == '#')
+                break;
+
+            size_t eq = item.find('=');
+            if (eq == string::npos || eq == 0 || eq + 1 == item.size())
+                return false;
+
+            std::vector<string> v;
+            std::stringstream list(item.substr(eq + 1));
+            string value;
+            while (std::getline(list, value, ','))
+                if (!value.empty())
+                    v.push_back(value);
+            if (v.empty())
+                return false;
+
+            values.push_back(std::make_pair(item.substr(0, eq), v));
+        }
+
+        if (values.empty())
+            continue;
+
+        // every combination, the last parameter changes fastest
+        std::vector<size_t> index(values.size(), 0);
+        for (;;) {
+            SweepConfig config;
+            for (size_t p = 0; p < values.size(); ++p)
+                config.push_back(std::make_pair(values[p].first, values[p].second[index[p]]));
+            configs.push_back(config);
+
+            size_t p = values.size();
+            while (p > 0 && ++index[p - 1] == values[p - 1].second.size())
+                index[--p] = 0;
+            if (p == 0)
+                break;
+        }
+    }
+
+    return !configs.empty();
+}
+
+string ParameterSweep::Name(const SweepConfig& config)
+{
+    std::stringstream str;
+    for (size_t p = 0; p < config.size(); ++p)
+        str << (p > 0 ? " " : "") << config[p].first << "=" << config[p].second;
+
+    return str.str();
+}
+
+string ParameterSweep::Apply(const string& xml, const SweepConfig& config)
+{
+    std::stringstream in(xml);
+    std::stringstream out;
+    string line;
+
+    // drop the lines of the swept parameters and the closing tag
+    while (std::getline(in, line)) {
+        bool keep = line.find("</" + XML_HEADER_TAG + ">") == string::npos;
+        for (size_t p = 0; keep && p < config.size(); ++p)
+            keep = line.find("<" + config[p].first + ">") == string::npos;
+        if (keep)
+            out << line << "\n";
+    }
+
+    for (size_t p = 0; p < config.size(); ++p)
+        out << "<" << config[p].first << ">" << config[p].second
+            << "</" << config[p].first << ">\n";
+    out << "</" << XML_HEADER_TAG << ">\n";
+
+    return out.str();
+}
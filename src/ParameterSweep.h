@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _PARAMETER_SWEEP_H
+#define _PARAMETER_SWEEP_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+using std::string;
+
+
+// Parameters of one configuration, named as in the config files
+typedef std::vector<std::pair<string, string> > SweepConfig;
+
+
+/*
+ * Configurations of a parameter sweep read from a text file. Each line
+ * lists parameters with one or more values,
+ *
+ *   Threshold=5,9,13 Alpha=0.001,0.01
+ *   Km=1.5 Kv=0.3,0.6
+ *
+ * and stands for all the combinations of its values (six and two
+ * configurations here). Lines starting with '#' are comments.
+ * Parameters not listed keep the value of the base config file.
+ */
+class ParameterSweep
+{
+
+public:
+
+    bool Load(const string& filename);
+
+    size_t Size() const { return configs.size(); };
+    const SweepConfig& operator[](size_t k) const { return configs[k]; };
+
+    // "Key=value Key=value"
+    static string Name(const SweepConfig& config);
+
+    // Config file text (OpenCV xml) with the values of config in place of
+    // its own, like run_client.sh edits config/*.xml
+    static string Apply(const string& xml, const SweepConfig& config);
+
+private:
+
+    std::vector<SweepConfig> configs;
+
+};
+
+
+#endif
@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "PixelTrace.h"
+
+
+bool PixelTraceRecorder::ParsePoints(const string& text, std::vector<Point>& points)
+{
+    points.clear();
+
+    // a file with one point per line, or the points themselves
+    string list;
+    std::ifstream in(text.c_str());
+    if (in.is_open()) {
+        std::stringstream str;
+        str << in.rdbuf();
+        list = str.str();
+    }
+    else {
+        list = text;
+    }
+
+    std::replace(list.begin(), list.end(), '\n', ';');
+
+    std::stringstream items(list);
+    string item;
+    while (std::getline(items, item, ';')) {
+        int x, y;
+        if (item.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        if (sscanf(item.c_str(), "%d , %d", &x, &y) != 2)
+            return false;
+        points.push_back(Point(x, y));
+    }
+
+    return !points.empty();
+}
+
+
+PixelTraceRecorder::PixelTraceRecorder()
+{
+    file  = NULL;
+    state = 0;
+}
+
+PixelTraceRecorder::~PixelTraceRecorder()
+{
+    Close();
+}
+
+bool PixelTraceRecorder::Open(const string& filename, const std::vector<Point>& _points,
+                              int _state, const string& layout)
+{
+    Close();
+
+    file = fopen(filename.c_str(), "wb");
+    if (file == NULL)
+        return false;
+
+    points = _points;
+    state  = _state;
+    buffer.clear();
+    buffer.reserve(PIXEL_TRACE_BLOCK + sizeof(PixelTraceRecord) + state*sizeof(float));
+
+    PixelTraceHeader header;
+    memcpy(header.magic, PIXEL_TRACE_MAGIC, 4);
+    header.version     = PIXEL_TRACE_VERSION;
+    header.points      = points.size();
+    header.state       = state;
+    header.layout_size = layout.size();
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (size_t k = 0; k < points.size() && written; ++k) {
+        int32_t xy[2] = { points[k].x, points[k].y };
+        written = fwrite(xy, sizeof(xy), 1, file) == 1;
+    }
+    written = written && fwrite(layout.data(), 1, layout.size(), file) == layout.size();
+
+    if (!written) {
+        fclose(file);
+        file = NULL;
+    }
+
+    return written;
+}
+
+bool PixelTraceRecorder::Add(int frame, int k, const Vec3b& bgr, uchar mask, const float* values)
+{
+    if (file == NULL)
+        return false;
+
+    PixelTraceRecord record;
+    record.frame  = frame;
+    record.point  = k;
+    record.bgr[0] = bgr[0];
+    record.bgr[1] = bgr[1];
+    record.bgr[2] = bgr[2];
+    record.mask   = mask;
+
+    const unsigned char* r = (const unsigned char*)&record;
+    const unsigned char* s = (const unsigned char*)values;
+    buffer.insert(buffer.end(), r, r + sizeof(record));
+    buffer.insert(buffer.end(), s, s + state*sizeof(float));
+
+    if (buffer.size() >= PIXEL_TRACE_BLOCK)
+        return Flush();
+
+    return true;
+}
+
+bool PixelTraceRecorder::Flush()
+{
+    if (file == NULL)
+        return false;
+
+    size_t written = buffer.empty() ? 0 : fwrite(&buffer[0], 1, buffer.size(), file);
+    bool ok = written == buffer.size();
+    buffer.clear();
+
+    if (!ok) {
+        fclose(file);
+        file = NULL;
+    }
+
+    return ok;
+}
+
+bool PixelTraceRecorder::Close()
+{
+    if (file == NULL)
+        return true;
+
+    bool ok = Flush();
+    if (file != NULL)
+        ok = (fclose(file) == 0) && ok;
+    file = NULL;
+
+    return ok;
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _PIXEL_TRACE_H
+#define _PIXEL_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using std::string;
+
+
+/*
+ * Trace of a list of pixels for debugging a model. Every frame adds one
+ * record per point, kept in memory and written in blocks of
+ * PIXEL_TRACE_BLOCK bytes. Layout (little endian):
+ *
+ *   PixelTraceHeader
+ *   int32_t x, y for each point
+ *   layout: names of the state values, header.layout_size characters
+ *   for each frame and point: PixelTraceRecord + float state[header.state]
+ *
+ * The state values are whatever the model reports for a pixel (IMBS bins,
+ * GMM modes), the layout text says what they are.
+ */
+const char     PIXEL_TRACE_MAGIC[4] = { 'B', 'G', 'P', 'T' };
+const uint32_t PIXEL_TRACE_VERSION  = 1;
+const size_t   PIXEL_TRACE_BLOCK    = 4 << 20;
+
+struct PixelTraceHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t points;
+    uint32_t state;         // floats of model state in each record
+    uint32_t layout_size;
+};
+
+struct PixelTraceRecord
+{
+    uint32_t frame;
+    uint32_t point;         // index in the point list
+    uint8_t  bgr[3];
+    uint8_t  mask;
+};
+
+
+class PixelTraceRecorder
+{
+
+public:
+
+    PixelTraceRecorder();
+    ~PixelTraceRecorder();
+
+    bool Open(const string& filename, const std::vector<Point>& points,
+              int state, const string& layout);
+    // Sample of point k, state holds the floats given to Open(). Add,
+    // Flush and Close are false when a write failed (a full disk, say),
+    // the recorder is closed then and ignores further samples.
+    bool Add(int frame, int k, const Vec3b& bgr, uchar mask, const float* state);
+    bool Flush();
+    bool Close();
+
+    bool IsOpen() const { return file != NULL; };
+    const std::vector<Point>& Points() const { return points; };
+
+    // "x,y;x,y;..." or the name of a file with a "x,y" point per line
+    static bool ParsePoints(const string& text, std::vector<Point>& points);
+
+private:
+
+    FILE* file;
+    std::vector<Point> points;
+    int state;
+    std::vector<unsigned char> buffer;
+
+};
+
+
+#endif
@@ -0,0 +1,265 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <stdio.h>
+#include <iostream>
+#include <ctype.h>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+
+#include "PrefetchFrameReader.h"
+
+using namespace boost::filesystem;
+using std::cout;
+using std::endl;
+
+
+// Compare digit sequences by value, everything else by character
+static bool natural_less(const string& a, const string& b)
+{
+    size_t i = 0, j = 0;
+
+    while (i < a.size() && j < b.size()) {
+        if (isdigit((unsigned char)a[i]) && isdigit((unsigned char)b[j])) {
+            size_t si = i, sj = j;
+            while (si < a.size() && a[si] == '0') ++si;
+            while (sj < b.size() && b[sj] == '0') ++sj;
+            size_t ei = si, ej = sj;
+            while (ei < a.size() && isdigit((unsigned char)a[ei])) ++ei;
+            while (ej < b.size() && isdigit((unsigned char)b[ej])) ++ej;
+
+            if (ei - si != ej - sj)
+                return ei - si < ej - sj;
+            int c = a.compare(si, ei - si, b, sj, ej - sj);
+            if (c != 0)
+                return c < 0;
+
+            i = ei;
+            j = ej;
+        }
+        else {
+            if (a[i] != b[j])
+                return a[i] < b[j];
+            ++i;
+            ++j;
+        }
+    }
+
+    return a.size() - i < b.size() - j;
+}
+
+// imdecode into an existing Mat leaves it untouched when no decoder takes
+// the data, so files are checked for a known image signature first
+static bool known_image(const std::vector<uchar>& b)
+{
+    if (b.size() < 4)
+        return false;
+
+    return (b[0] == 0xff && b[1] == 0xd8) ||                           // jpeg
+           (b[0] == 0x89 && b[1] == 'P' && b[2] == 'N' && b[3] == 'G') || // png
+           (b[0] == 'B'  && b[1] == 'M') ||                            // bmp
+           (b[0] == 'P'  && b[1] >= '1' && b[1] <= '6') ||             // pnm
+           (b[0] == 'I'  && b[1] == 'I' && b[2] == 42) ||              // tiff
+           (b[0] == 'M'  && b[1] == 'M' && b[3] == 42);
+}
+
+bool PrefetchFrameReader::ListImageFiles(const string& dir, std::vector<string>& files)
+{
+    static const char* extensions[] = { ".jpg", ".jpeg", ".png", ".bmp", ".ppm", ".pgm", ".tif", ".tiff" };
+
+    files.clear();
+    if (!is_directory(dir))
+        return false;
+
+    std::vector<string> names;
+    for (directory_iterator it(dir), end; it != end; ++it) {
+        if (!is_regular_file(it->status()))
+            continue;
+
+        string ext = it->path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        for (size_t e = 0; e < sizeof(extensions)/sizeof(extensions[0]); ++e) {
+            if (ext == extensions[e]) {
+                names.push_back(it->path().filename().string());
+                break;
+            }
+        }
+    }
+
+    std::sort(names.begin(), names.end(), natural_less);
+    for (size_t k = 0; k < names.size(); ++k)
+        files.push_back((path(dir) / names[k]).string());
+
+    return !files.empty();
+}
+
+
+PrefetchFrameReader::PrefetchFrameReader(seq::FrameReader* _reader, const string& _input,
+                                         int depth, int _threads)
+    : reader(_reader), input(_input), threads(_threads),
+      next_decode(0), next_read(0), stop(false)
+{
+    if (!ListImageFiles(input, files) || depth <= 0)
+        return;
+
+    // the helpers would read another sequence than the FrameReader, whose
+    // count --range and the masks go by
+    if ((int)files.size() != reader->getNFrames()) {
+        cout << "Not prefetching: " << files.size() << " image files in " << input
+             << ", the frame reader has " << reader->getNFrames() << " frames" << endl;
+        files.clear();
+        return;
+    }
+
+    if (threads <= 0) {
+        // leave a core to the model
+        int cores = std::thread::hardware_concurrency();
+        threads = std::min(std::max(cores - 1, 1), 4);
+    }
+    threads = std::min(threads, depth);
+
+    ring.resize(depth);
+    Start();
+}
+
+PrefetchFrameReader::~PrefetchFrameReader()
+{
+    Stop();
+}
+
+void PrefetchFrameReader::Start()
+{
+    stop = false;
+    for (size_t s = 0; s < ring.size(); ++s) {
+        ring[s].frame = 0;
+        ring[s].ready = false;
+    }
+
+    for (int t = 0; t < threads; ++t)
+        workers.push_back(std::thread(&PrefetchFrameReader::Decode, this));
+}
+
+void PrefetchFrameReader::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop = true;
+    }
+    slot_free.notify_all();
+
+    for (size_t t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    workers.clear();
+}
+
+bool PrefetchFrameReader::Seek(int frame)
+{
+    if (frame <= 0)
+        return true;
+
+    // prefetched image files: restart the helpers at the frame
+    if (!workers.empty()) {
+        Stop();
+        next_decode = next_read = frame;
+        Start();
+        return (size_t)frame < files.size();
+    }
+
+    // read up to the frame, a video's own seek is not frame accurate with
+    // every codec
+    Mat skip;
+    for (int k = 0; k < frame; ++k) {
+        reader->getFrame(skip);
+        if (skip.empty())
+            return false;
+    }
+
+    return true;
+}
+
+void PrefetchFrameReader::Decode()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+
+    for (;;) {
+        // a slot is free once the frame depth places back was handed over
+        slot_free.wait(lock, [this] {
+            return stop || next_decode >= files.size() ||
+                   next_decode < next_read + ring.size();
+        });
+        if (stop || next_decode >= files.size())
+            return;
+
+        size_t k = next_decode++;
+        Slot& slot = ring[k % ring.size()];
+        lock.unlock();
+
+        // read the whole file and decode into the buffers of the slot
+        slot.buffer.clear();
+        FILE* f = fopen(files[k].c_str(), "rb");
+        if (f != NULL) {
+            fseek(f, 0, SEEK_END);
+            long size = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            if (size > 0) {
+                slot.buffer.resize(size);
+                if (fread(&slot.buffer[0], 1, size, f) != (size_t)size)
+                    slot.buffer.clear();
+            }
+            fclose(f);
+        }
+
+        if (!known_image(slot.buffer))
+            slot.image.release();
+        else
+            imdecode(slot.buffer, CV_LOAD_IMAGE_COLOR, &slot.image);
+
+        lock.lock();
+        slot.frame = k;
+        slot.ready = true;
+        slot_ready.notify_all();
+    }
+}
+
+void PrefetchFrameReader::getFrame(Mat& frame)
+{
+    if (workers.empty()) {
+        reader->getFrame(frame);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+
+    if (next_read >= files.size()) {
+        frame.release();
+        return;
+    }
+
+    Slot& slot = ring[next_read % ring.size()];
+    slot_ready.wait(lock, [&] { return slot.ready && slot.frame == next_read; });
+
+    // the caller's Mat becomes the next decode buffer, unless someone
+    // else still holds a reference to its data
+    std::swap(frame, slot.image);
+    if (slot.image.refcount != NULL && *slot.image.refcount > 1)
+        slot.image.release();
+
+    slot.ready = false;
+    ++next_read;
+    lock.unlock();
+
+    slot_free.notify_all();
+}
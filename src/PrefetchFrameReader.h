@@ -0,0 +1,100 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _PREFETCH_FRAME_READER_H
+#define _PREFETCH_FRAME_READER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+#include "FrameReaderFactory.h"
+
+using namespace cv;
+using std::string;
+
+
+/*
+ * Frame source of the drivers. For a directory of image files the next
+ * frames are decoded ahead on helper threads into a ring of Mats, and
+ * getFrame() hands them over in order. Any other input (or depth 0)
+ * reads straight from the FrameReader.
+ *
+ * The FrameReader still answers the size, channels and delay queries.
+ * The helpers list the directory themselves (ListImageFiles, decoded as
+ * colour). When that list does not have the FrameReader's frame count
+ * the directory is read through the FrameReader instead, with a warning.
+ */
+class PrefetchFrameReader
+{
+
+public:
+
+    // depth: frames decoded ahead, threads: helpers, 0 picks from the cores
+    PrefetchFrameReader(seq::FrameReader* reader, const string& input,
+                        int depth, int threads = 0);
+    ~PrefetchFrameReader();
+
+    // Next frame, empty at the end of the sequence. The Mat given in is
+    // kept as a decode buffer, so frames are never copied.
+    void getFrame(Mat& frame);
+
+    // Make frame (0 based) the next one returned, call it before reading.
+    // Prefetched directories jump there, other inputs are read up to it
+    // through the FrameReader. False when the sequence is shorter.
+    bool Seek(int frame);
+
+    bool IsPrefetching() const { return !workers.empty(); };
+
+    // Image files of a directory in natural order (2.jpg before 10.jpg)
+    static bool ListImageFiles(const string& path, std::vector<string>& files);
+
+private:
+
+    struct Slot
+    {
+        Mat image;
+        std::vector<uchar> buffer;  // file contents, reused
+        size_t frame;
+        bool ready;
+    };
+
+    void Decode();
+    void Start();
+    void Stop();
+
+    seq::FrameReader* reader;
+    string input;
+    int threads;
+    std::vector<string> files;
+    std::vector<Slot> ring;
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable slot_ready;
+    std::condition_variable slot_free;
+    size_t next_decode;
+    size_t next_read;
+    bool stop;
+
+};
+
+
+#endif
@@ -0,0 +1,158 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <cmath>
+#include <algorithm>
+
+#include "SceneGenerator.h"
+
+
+static const double TWO_PI = 6.283185307179586;
+
+// Shadows darken the background to this fraction, cast down and right
+static const double SHADOW_GAIN   = 0.55;
+static const double SHADOW_OFFSET = 0.4;   // of the blob axes
+
+
+SceneGenerator::SceneGenerator(const SceneParams& p)
+    : params(p)
+{
+    RNG rng(params.seed);
+    const Size size = params.size;
+    const int side  = std::min(size.width, size.height);
+
+    background = Texture(rng, size, std::max(2, side/16));
+
+    // waving texture moves a few pixels around its place
+    int amplitude = std::max(2, side/60);
+    foliage = Texture(rng, Size(size.width + 2*amplitude, size.height + 2*amplitude), 3);
+
+    for (int d = 0; d < params.dynamicRegions; ++d) {
+        Dynamic region;
+        int w = rng.uniform(side/6, side/3 + 1);
+        int h = rng.uniform(side/6, side/3 + 1);
+        region.rect      = Rect(rng.uniform(0, std::max(1, size.width - w)),
+                                rng.uniform(0, std::max(1, size.height - h)), w, h)
+                           & Rect(0, 0, size.width, size.height);
+        region.amplitude = amplitude;
+        region.period    = rng.uniform(8., 40.);
+        region.phase     = rng.uniform(0., TWO_PI);
+        dynamics.push_back(region);
+    }
+
+    illuminationPeriod = rng.uniform(300., 900.);
+
+    // blobs of a fixed size, as many as the fraction asks for
+    Size axes(std::max(4, side/12), std::max(6, side/8));
+    int count = (int)std::ceil(params.foreground*size.area()/(CV_PI*axes.width*axes.height));
+    for (int b = 0; b < count; ++b) {
+        Blob blob;
+        blob.axes     = axes;
+        blob.start    = Point2f(rng.uniform(0.f, (float)size.width),
+                                rng.uniform(0.f, (float)size.height));
+        blob.velocity = Point2f(rng.uniform(-3.f, 3.f), rng.uniform(-2.f, 2.f));
+        blob.color    = Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        blobs.push_back(blob);
+    }
+}
+
+// Fine grain on top of coarse shapes, like ground and walls
+Mat SceneGenerator::Texture(RNG& rng, Size size, int grain)
+{
+    Mat coarse(Size(std::max(2, size.width/(8*grain)), std::max(2, size.height/(8*grain))), CV_8UC3);
+    rng.fill(coarse, RNG::UNIFORM, Scalar::all(30), Scalar::all(220));
+    resize(coarse, coarse, size, 0, 0, INTER_LINEAR);
+
+    Mat fine(size, CV_8UC3);
+    rng.fill(fine, RNG::UNIFORM, Scalar::all(0), Scalar::all(255));
+    GaussianBlur(fine, fine, Size(2*grain + 1, 2*grain + 1), 0);
+
+    Mat texture;
+    addWeighted(coarse, 0.7, fine, 0.3, 0., texture);
+
+    return texture;
+}
+
+// Position at frame k, bouncing off the frame edges
+Point SceneGenerator::BlobCenter(const Blob& blob, int k) const
+{
+    const float pos[2]   = { blob.start.x + k*blob.velocity.x, blob.start.y + k*blob.velocity.y };
+    const float range[2] = { (float)params.size.width, (float)params.size.height };
+    float center[2];
+
+    for (int c = 0; c < 2; ++c) {
+        float m = std::fmod(std::fabs(pos[c]), 2.f*range[c]);
+        center[c] = m <= range[c] ? m : 2.f*range[c] - m;
+    }
+
+    return Point(cvRound(center[0]), cvRound(center[1]));
+}
+
+void SceneGenerator::Render(int k, Mat& frame, Mat& truth)
+{
+    const Size size = params.size;
+
+    background.copyTo(frame);
+    truth.create(size, CV_8UC1);
+    truth.setTo(Scalar::all(SCENE_BACKGROUND));
+
+    // dynamic regions show the foliage shifted back and forth
+    for (size_t d = 0; d < dynamics.size(); ++d) {
+        const Dynamic& region = dynamics[d];
+        double angle = TWO_PI*k/region.period + region.phase;
+        int dx = cvRound(region.amplitude*std::sin(angle));
+        int dy = cvRound(0.5*region.amplitude*std::sin(1.7*angle));
+        Rect from = region.rect + Point(region.amplitude + dx, region.amplitude + dy);
+        foliage(from).copyTo(frame(region.rect));
+    }
+
+    // shadows first so that the blobs cover their own
+    if (params.shadows && !blobs.empty()) {
+        shadowMask.create(size, CV_8UC1);
+        shadowMask.setTo(Scalar::all(0));
+        for (size_t b = 0; b < blobs.size(); ++b) {
+            const Blob& blob = blobs[b];
+            Point offset(cvRound(SHADOW_OFFSET*blob.axes.width), cvRound(SHADOW_OFFSET*blob.axes.height));
+            ellipse(shadowMask, BlobCenter(blob, k) + offset, blob.axes, 0, 0, 360,
+                    Scalar::all(255), CV_FILLED);
+        }
+        Mat dark;
+        frame.convertTo(dark, -1, SHADOW_GAIN);
+        dark.copyTo(frame, shadowMask);
+        truth.setTo(Scalar::all(SCENE_SHADOW), shadowMask);
+    }
+
+    for (size_t b = 0; b < blobs.size(); ++b) {
+        const Blob& blob = blobs[b];
+        Point center = BlobCenter(blob, k);
+        ellipse(frame, center, blob.axes, 0, 0, 360, blob.color, CV_FILLED);
+        ellipse(truth, center, blob.axes, 0, 0, 360, Scalar::all(SCENE_FOREGROUND), CV_FILLED);
+    }
+
+    // global brightness drifts slowly, as through a day or clouds
+    if (params.illumination > 0.) {
+        double gain = 1. + params.illumination*std::sin(TWO_PI*k/illuminationPeriod);
+        frame.convertTo(frame, -1, gain);
+    }
+
+    // noise of frame k depends only on the seed and k
+    if (params.noise > 0.) {
+        RNG rng((uint64)params.seed*0x9E3779B1u + (uint64)k + 1);
+        noise.create(size, CV_16SC3);
+        rng.fill(noise, RNG::NORMAL, Scalar::all(0), Scalar::all(params.noise));
+        add(frame, noise, frame, noArray(), CV_8UC3);
+    }
+}
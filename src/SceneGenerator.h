@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _SCENE_GENERATOR_H
+#define _SCENE_GENERATOR_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+
+
+// Ground-truth labels of the generated masks
+const uchar SCENE_BACKGROUND = 0;
+const uchar SCENE_SHADOW     = 50;
+const uchar SCENE_FOREGROUND = 255;
+
+struct SceneParams
+{
+    SceneParams()
+        : size(320, 240), seed(1), foreground(0.05), noise(3.),
+          dynamicRegions(2), illumination(0.1), shadows(true) {}
+
+    Size   size;
+    int    seed;
+    double foreground;      // fraction of the frame covered by moving blobs
+    double noise;           // standard deviation of the sensor noise
+    int    dynamicRegions;  // areas of waving texture (trees, water)
+    double illumination;    // amplitude of the brightness drift, 0.1 is +-10%
+    bool   shadows;         // blobs cast a shadow
+};
+
+
+/*
+ * Synthetic sequence with ground truth for benchmarks that can not ship
+ * the Activity videos. A textured background with regions that wave
+ * back and forth, a slow illumination drift, blobs that bounce around
+ * the frame with their shadows, and sensor noise.
+ *
+ * Everything follows from the seed, and Render(k) only depends on k, so
+ * frames can be rendered in any order and the same seed gives the same
+ * sequence on every machine.
+ */
+class SceneGenerator
+{
+
+public:
+
+    explicit SceneGenerator(const SceneParams& params);
+
+    // Frame k (CV_8UC3) and its ground truth (CV_8UC1): SCENE_FOREGROUND,
+    // SCENE_SHADOW or SCENE_BACKGROUND, dynamic regions are background
+    void Render(int k, Mat& frame, Mat& truth);
+
+    const SceneParams& Params() const { return params; };
+
+private:
+
+    struct Dynamic
+    {
+        Rect   rect;
+        int    amplitude;   // pixels
+        double period;      // frames
+        double phase;
+    };
+
+    struct Blob
+    {
+        Point2f start;
+        Point2f velocity;   // pixels per frame
+        Size    axes;
+        Scalar  color;
+    };
+
+    static Mat Texture(RNG& rng, Size size, int grain);
+    Point BlobCenter(const Blob& blob, int k) const;
+
+    SceneParams params;
+    Mat background;
+    Mat foliage;            // texture of the dynamic regions, with margins
+    std::vector<Dynamic> dynamics;
+    std::vector<Blob> blobs;
+    double illuminationPeriod;
+    Mat noise;
+    Mat shadowMask;
+
+};
+
+
+#endif
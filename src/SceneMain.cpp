@@ -0,0 +1,239 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <sstream>
+#include <chrono>
+
+#include "BGSSystem.h"
+#include "IMBSBuilder.h"
+#include "T2FGMM_UMBuilder.h"
+#include "T2FMRF_UMBuilder.h"
+
+#include "MaskArchive.h"
+#include "MaskRLE.h"
+#include "GroundTruthEvaluator.h"
+#include "SceneGenerator.h"
+
+using namespace cv;
+using namespace std;
+using namespace boost::filesystem;
+using namespace bgs;
+
+
+const char* keys =
+{
+    "{ s | size       | 320x240 | Frame size }"
+    "{ n | frames     | 300     | Frames generated }"
+    "{ d | seed       | 1       | Seed of the scene }"
+    "{ g | foreground | 0.05    | Fraction of the frame covered by moving blobs }"
+    "{ z | noise      | 3       | Standard deviation of the sensor noise }"
+    "{ y | dynamic    | 2       | Regions of waving texture, trees or water }"
+    "{ l | illumination | 0.1   | Amplitude of the illumination drift, 0.1 is +-10% }"
+    "{ w | shadows    | true    | Blobs cast shadows, labelled 50 in the ground truth }"
+    "{ o | output     |         | Write <dir>/input/<k>.png frames and <dir>/groundtruth/gt<k>.png masks }"
+    "{ a | algorithm  |         | Run imbs, t2fgmm_um or t2fmrf_um on the frames, scores to <alg>_scene_scores.txt }"
+    "{ h | help       | false   | Print help message }"
+};
+
+void display_message()
+{
+    cout << "Synthetic sequences with ground truth.                      " << endl;
+    cout << "------------------------------------------------------------" << endl;
+    cout << "Renders a seeded scene with waving regions, illumination    " << endl;
+    cout << "drift, moving blobs, shadows and noise. Writes the frames   " << endl;
+    cout << "and masks out, or runs an algorithm on them and scores it.  " << endl;
+    cout << "OpenCV Version : "  << CV_VERSION << endl;
+    cout << "Example:                                                    " << endl;
+    cout << "bgs_scene -s 640x480 -n 500 -d 7 -o scene7                  " << endl;
+    cout << "bgs_scene -s 640x480 -n 500 -d 7 -a t2fgmm_um               " << endl << endl;
+    cout << "------------------------------------------------------------" << endl <<endl;
+}
+
+
+// Builder of the algorithm with the parameters of config/<alg>.xml
+static IBGSAlgorithm* create_builder(const string& algorithm, Size size, string& name)
+{
+    if (algorithm == "imbs") {
+        name = "IMBS";
+        return new IMBSBuilder();
+    }
+    if (algorithm == "t2fgmm_um") {
+        name = "T2FGMM_UM";
+        return new T2FGMM_UMBuilder(size.width, size.height, 3);
+    }
+    if (algorithm == "t2fmrf_um") {
+        name = "T2FMRF_UM";
+        return new T2FMRF_UMBuilder(size.width, size.height, 3);
+    }
+
+    return NULL;
+}
+
+// WarmupFrames of the builder's config, the frames before are not scored
+static int warmup_frames(IBGSAlgorithm* builder)
+{
+    if (IMBSBuilder* imbs = dynamic_cast<IMBSBuilder*>(builder))
+        return imbs->WarmupFrames();
+    if (T2FGMM_UMBuilder* t2fgmm = dynamic_cast<T2FGMM_UMBuilder*>(builder))
+        return t2fgmm->WarmupFrames();
+    if (T2FMRF_UMBuilder* t2fmrf = dynamic_cast<T2FMRF_UMBuilder*>(builder))
+        return t2fmrf->WarmupFrames();
+
+    return 0;
+}
+
+
+int main( int argc, char** argv )
+{
+    //Parse console parameters
+    CommandLineParser cmd(argc, argv, keys);
+
+    // Reading input parameters
+    const string frameSize                = cmd.get<string>("size");
+    const int maxFrames                   = cmd.get<int>("frames");
+    const string outputPath               = cmd.get<string>("output");
+    const string algorithm                = cmd.get<string>("algorithm");
+
+    SceneParams params;
+    params.seed           = cmd.get<int>("seed");
+    params.foreground     = cmd.get<double>("foreground");
+    params.noise          = cmd.get<double>("noise");
+    params.dynamicRegions = cmd.get<int>("dynamic");
+    params.illumination   = cmd.get<double>("illumination");
+    params.shadows        = cmd.get<bool>("shadows");
+
+    // Show help not input options
+    if (cmd.get<bool>("help") || (outputPath.empty() && algorithm.empty())) {
+        display_message();
+        cmd.printParams();
+        return 0;
+    }
+
+    if (sscanf(frameSize.c_str(), "%dx%d", &params.size.width, &params.size.height) != 2 ||
+        params.size.width <= 0 || params.size.height <= 0 || maxFrames <= 0) {
+        cout << "Invalid frame size or number of frames" << endl;
+        return 0;
+    }
+
+    // Frames named as image sequences are read back, masks numbered for
+    // the ground-truth evaluator
+    string inputPath = outputPath + "/input";
+    string truthPath = outputPath + "/groundtruth";
+    if (!outputPath.empty()) {
+        create_directories(inputPath);
+        create_directories(truthPath);
+    }
+
+    // The generated frames go straight into the algorithm
+    BGSSystem* bgs = NULL;
+    string algName;
+    int warmupFrames = 0;
+    if (!algorithm.empty()) {
+        IBGSAlgorithm* builder = create_builder(algorithm, params.size, algName);
+        if (builder == NULL) {
+            cout << "Unknown algorithm " << algorithm << endl;
+            return 0;
+        }
+        bgs = new BGSSystem();
+        bgs->setAlgorithm(builder);
+        bgs->setName(algName);
+        bgs->loadConfigParameters();
+        bgs->initializeAlgorithm();
+        warmupFrames = warmup_frames(builder);
+    }
+
+    SceneGenerator scene(params);
+    Mat Frame, Truth, Foreground;
+    vector<uint64_t> truthBits, maskBits;
+    vector<FrameScore> scores;
+    double seconds = 0.;
+    int timedFrames = 0;
+
+    vector<int> compression_params;
+    compression_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
+    compression_params.push_back(9);
+
+    for (int cnt = 0; cnt < maxFrames; ++cnt) {
+
+        scene.Render(cnt, Frame, Truth);
+
+        if (!outputPath.empty()) {
+            stringstream str;
+            str << inputPath << "/" << setw(6) << setfill('0') << cnt << ".png";
+            imwrite(str.str(), Frame, compression_params);
+
+            str.str("");
+            str << truthPath << "/gt" << setw(6) << setfill('0') << cnt << ".png";
+            imwrite(str.str(), Truth, compression_params);
+        }
+
+        if (bgs != NULL) {
+            Foreground = Scalar::all(0);
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            bgs->updateAlgorithm(Frame, Foreground);
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+            // the model is still learning the scene, as with --seek in the
+            // drivers these frames are neither scored nor timed
+            if (cnt < warmupFrames)
+                continue;
+
+            seconds += elapsed;
+            timedFrames += 1;
+
+            // shadows are below 127, the background the algorithm should give
+            truthBits.assign(mask_words(Truth.total()), 0);
+            pack_mask_bits(Truth, (unsigned char*)&truthBits[0]);
+            scores.push_back(GroundTruthEvaluator::Score(cnt, Foreground, truthBits, maskBits));
+        }
+    }
+
+    if (!outputPath.empty())
+        cout << "Wrote " << maxFrames << " frames to " << inputPath
+             << " and their ground truth to " << truthPath << endl;
+
+    // Scores with the parameters and the scene that produced them
+    if (bgs != NULL) {
+        FrameScore total = GroundTruthEvaluator::Total(scores);
+        cout << "Scored " << total.frame << " frames after " << warmupFrames << " warm-up frames: "
+             << "precision " << total.Precision() << " "
+             << "recall "    << total.Recall()    << " "
+             << "fmeasure "  << total.FMeasure()  << " "
+             << "ms/frame "  << (timedFrames > 0 ? 1000.*seconds/timedFrames : 0.) << endl;
+
+        stringstream header;
+        header << bgs->getConfigurationParameters()
+               << "\n# scene size=" << params.size.width << "x" << params.size.height
+               << " seed=" << params.seed << " foreground=" << params.foreground
+               << " noise=" << params.noise << " dynamic=" << params.dynamicRegions
+               << " illumination=" << params.illumination << " shadows=" << params.shadows
+               << " warmup=" << warmupFrames;
+        GroundTruthEvaluator::WriteSummary(algorithm + "_scene_scores.txt",
+                                           header.str(), scores);
+        delete bgs;
+    }
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "StageTimer.h"
+
+
+// Bucket of a duration in microseconds: 0-3 one each, then four buckets
+// per power of two
+static int bucket_index(uint64_t us)
+{
+    if (us < 4)
+        return (int)us;
+
+    int e = 63 - __builtin_clzll(us);
+    int k = 4*(e - 1) + (int)((us >> (e - 2)) & 3);
+
+    return std::min(k, StageHistogram::Buckets - 1);
+}
+
+// Middle of a bucket in microseconds
+static double bucket_value(int k)
+{
+    if (k < 4)
+        return k + 0.5;
+
+    int e = k/4 + 1;
+    uint64_t step = (uint64_t)1 << (e - 2);
+    return (double)((4 + k % 4)*step) + 0.5*step;
+}
+
+
+StageHistogram::StageHistogram()
+    : count(0), total(0), min(0), max(0), last(0)
+{
+    std::fill(bucket, bucket + Buckets, 0);
+}
+
+void StageHistogram::Add(int64_t ns)
+{
+    if (count == 0 || ns < min) min = ns;
+    if (count == 0 || ns > max) max = ns;
+    count += 1;
+    total += ns;
+    last   = ns;
+    bucket[bucket_index(ns > 0 ? (uint64_t)ns/1000 : 0)] += 1;
+}
+
+void StageHistogram::Merge(const StageHistogram& other)
+{
+    if (other.count == 0)
+        return;
+
+    if (count == 0 || other.min < min) min = other.min;
+    if (count == 0 || other.max > max) max = other.max;
+    count += other.count;
+    total += other.total;
+    last   = other.last;
+    for (int k = 0; k < Buckets; ++k)
+        bucket[k] += other.bucket[k];
+}
+
+double StageHistogram::Percentile(double p) const
+{
+    if (count == 0)
+        return 0.;
+
+    uint64_t rank = std::max((uint64_t)(p*count + 0.5), (uint64_t)1);
+    uint64_t seen = 0;
+    int k = 0;
+    for (; k < Buckets - 1; ++k) {
+        seen += bucket[k];
+        if (seen >= rank)
+            break;
+    }
+
+    // the bucket middle, never outside what was measured
+    double ms = 1e-3*bucket_value(k);
+    return std::min(std::max(ms, 1e-6*min), 1e-6*max);
+}
+
+
+int StageTimer::Stage(const string& name)
+{
+    for (size_t k = 0; k < stages.size(); ++k)
+        if (stages[k].name == name)
+            return (int)k;
+
+    Entry entry;
+    entry.name      = name;
+    entry.traceName = ChromeTrace::Name(name);
+    stages.push_back(entry);
+
+    return (int)stages.size() - 1;
+}
+
+void StageTimer::Merge(const StageTimer& other)
+{
+    for (size_t k = 0; k < other.stages.size(); ++k)
+        stages[Stage(other.stages[k].name)].histogram.Merge(other.stages[k].histogram);
+}
+
+void StageTimer::Reset()
+{
+    for (size_t k = 0; k < stages.size(); ++k)
+        stages[k].histogram = StageHistogram();
+}
+
+string StageTimer::Report(const string& title) const
+{
+    std::stringstream str;
+    str << "# " << title << "\n";
+    str << "# stage             count    mean ms     p50 ms     p99 ms     max ms    total s\n";
+
+    for (size_t k = 0; k < stages.size(); ++k) {
+        const StageHistogram& h = stages[k].histogram;
+        if (h.count == 0)
+            continue;
+
+        str << std::left  << std::setw(16) << stages[k].name
+            << std::right << std::setw(9)  << h.count
+            << std::fixed << std::setprecision(3)
+            << std::setw(11) << h.Mean()
+            << std::setw(11) << h.Percentile(0.50)
+            << std::setw(11) << h.Percentile(0.99)
+            << std::setw(11) << 1e-6*h.max
+            << std::setw(11) << 1e-9*h.total
+            << "\n";
+    }
+
+    return str.str();
+}
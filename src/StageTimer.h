@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _STAGE_TIMER_H
+#define _STAGE_TIMER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "ChromeTrace.h"
+
+using std::string;
+
+
+/*
+ * Durations of one stage. Buckets split each power of two of microseconds
+ * in four, so percentiles are within 25% of the true value, and adding a
+ * duration is a few integer operations.
+ */
+struct StageHistogram
+{
+    static const int Buckets = 128;
+
+    StageHistogram();
+
+    void Add(int64_t ns);
+    void Merge(const StageHistogram& other);
+
+    // Milliseconds, p in [0,1]
+    double Percentile(double p) const;
+    double Mean() const { return count > 0 ? 1e-6*total/count : 0.; };
+
+    uint64_t count;
+    int64_t  total;     // nanoseconds
+    int64_t  min;
+    int64_t  max;
+    int64_t  last;
+    uint64_t bucket[Buckets];
+};
+
+
+/*
+ * Timers of the stages of a pipeline on the monotonic clock. Stages are
+ * registered by name once, then each frame marks where a stage ends:
+ *
+ *   StageTimer::Clock::time_point t = StageTimer::Clock::now();
+ *   model->Subtract(...);
+ *   t = timing.Mark(stageSubtract, t);
+ *   model->Update(...);
+ *   t = timing.Mark(stageUpdate, t);
+ *
+ * A timer is not thread safe, each thread keeps its own and Merge() joins
+ * them for the report. With ChromeTrace enabled every stage is also a span
+ * of the timeline, under the category of the timer.
+ */
+class StageTimer
+{
+
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    explicit StageTimer(const string& category = "stage")
+        : traceCategory(ChromeTrace::Name(category)) {}
+
+    // Id of the named stage, registered on first use
+    int Stage(const string& name);
+
+    void Add(int stage, Clock::time_point begin, Clock::time_point end)
+    {
+        stages[stage].histogram.Add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        ChromeTrace::Span(stages[stage].traceName, traceCategory, begin, end);
+    };
+
+    // Time since begin goes to the stage, returns now for the next stage
+    Clock::time_point Mark(int stage, Clock::time_point begin)
+    {
+        Clock::time_point now = Clock::now();
+        Add(stage, begin, now);
+        return now;
+    };
+
+    size_t Stages() const { return stages.size(); };
+    const string& Name(int stage) const { return stages[stage].name; };
+    const StageHistogram& Histogram(int stage) const { return stages[stage].histogram; };
+
+    // Milliseconds of the last time of the stage
+    double Last(int stage) const { return 1e-6*stages[stage].histogram.last; };
+
+    // Adds the stages of other, matched by name
+    void Merge(const StageTimer& other);
+    void Reset();
+
+    // One line per stage: count, mean, p50, p99, max and total
+    string Report(const string& title) const;
+
+private:
+
+    struct Entry
+    {
+        string name;
+        int    traceName;
+        StageHistogram histogram;
+    };
+
+    std::vector<Entry> stages;
+    int traceCategory;
+
+};
+
+
+#endif
@@ -0,0 +1,315 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <opencv2/opencv.hpp>
+
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+
+#include "IMBSBuilder.h"
+#include "T2FGMM_UMBuilder.h"
+#include "T2FMRF_UMBuilder.h"
+#include "FrameReaderFactory.h"
+
+#include "utils.h"
+#include "PrefetchFrameReader.h"
+#include "GroundTruthEvaluator.h"
+#include "ParameterSweep.h"
+#include "WorkerPool.h"
+
+using namespace cv;
+using namespace std;
+using namespace boost::filesystem;
+using namespace seq;
+
+
+const char* keys =
+{
+    "{ f | input     |           | Input video }"
+    "{ a | algorithm | t2fgmm_um | Algorithm: imbs, t2fgmm_um or t2fmrf_um }"
+    "{ c | configs   |           | Sweep file, a line Threshold=5,9 Alpha=0.001,0.01 runs every combination }"
+    "{ g | groundtruth |         | Directory of ground-truth images }"
+    "{ r | range     |           | Frames scored against the ground truth, e.g -r 200,628 }"
+    "{ k | seek      | false     | Start at the range start minus the largest WarmupFrames }"
+    "{ n | threads   | 0         | Threads running the configurations, 0 uses all cores }"
+    "{ j | prefetch  | 8         | Frames decoded ahead on helper threads for image directories, 0 disables, off when the files do not match the FrameReader frame count }"
+    "{ h | help      | false     | Print help message }"
+};
+
+void display_message()
+{
+    cout << "Background Subtraction Parameter Sweep.                     " << endl;
+    cout << "------------------------------------------------------------" << endl;
+    cout << "Run many configurations of an algorithm on one decode of the" << endl;
+    cout << "input, each one scored against the ground truth.            " << endl;
+    cout << "OpenCV Version : "  << CV_VERSION << endl;
+    cout << "Example:                                                    " << endl;
+    cout << "bgs_sweep -f movie_file -a t2fgmm_um -c sweep.txt -g gt_dir -r 200,628" << endl << endl;
+    cout << "------------------------------------------------------------" << endl <<endl;
+}
+
+
+// One configuration of the sweep and what it produced
+struct SweepRun
+{
+    IBGSAlgorithm* builder;
+    int warmupFrames;
+    string name;
+    std::vector<FrameScore> scores;
+    std::vector<uint64_t> bits;     // scratch of the scoring
+    Mat mask;
+    double seconds;
+};
+
+
+template <class Builder>
+static IBGSAlgorithm* configure(Builder* builder, const string& config, SweepRun& run)
+{
+    builder->LoadConfigParameters(config);
+    builder->Initialization();
+    run.warmupFrames = builder->WarmupFrames();
+
+    return builder;
+}
+
+// Builder of the algorithm with the parameters of a config file
+static IBGSAlgorithm* create_builder(const string& algorithm, const string& config,
+                                     FrameReader* input, SweepRun& run)
+{
+    int cols = input->getNumberCols();
+    int rows = input->getNumberRows();
+
+    if (algorithm == "imbs")
+        return configure(new IMBSBuilder(Size(cols, rows), CV_8UC3), config, run);
+
+    // The pool already runs one configuration per core, the models run
+    // on the thread of their task (IMBS has no threads of its own)
+    if (algorithm == "t2fgmm_um") {
+        T2FGMM_UMBuilder* builder = new T2FGMM_UMBuilder(cols, rows, input->getNChannels());
+        builder->SetThreads(1);
+        return configure(builder, config, run);
+    }
+    if (algorithm == "t2fmrf_um") {
+        T2FMRF_UMBuilder* builder = new T2FMRF_UMBuilder(cols, rows, input->getNChannels());
+        builder->SetThreads(1);
+        return configure(builder, config, run);
+    }
+
+    return NULL;
+}
+
+// Base config file of the algorithm, written with the defaults when missing
+static bool read_base_config(const string& algorithm, string& xml)
+{
+    string filename = "config/" + algorithm + ".xml";
+
+    if (!exists(filename)) {
+        IBGSAlgorithm* builder = NULL;
+        if (algorithm == "imbs")
+            builder = new IMBSBuilder();
+        else if (algorithm == "t2fgmm_um")
+            builder = new T2FGMM_UMBuilder();
+        else if (algorithm == "t2fmrf_um")
+            builder = new T2FMRF_UMBuilder();
+        else
+            return false;
+
+        builder->LoadConfigParameters();
+        delete builder;
+    }
+
+    std::ifstream in(filename.c_str());
+    std::stringstream str;
+    str << in.rdbuf();
+    xml = str.str();
+
+    return !xml.empty();
+}
+
+
+int main( int argc, char** argv )
+{
+    //Parse console parameters
+    CommandLineParser cmd(argc, argv, keys);
+
+    // Reading input parameters
+    const string inputName                = cmd.get<string>("input");
+    const string algorithm                = cmd.get<string>("algorithm");
+    const string sweepFile                = cmd.get<string>("configs");
+    const string groundTruth              = cmd.get<string>("groundtruth");
+    const string rangeFrames              = cmd.get<string>("range");
+    const bool seekRange                  = cmd.get<bool>("seek");
+    const int threads                     = cmd.get<int>("threads");
+    const int prefetchFrames              = cmd.get<int>("prefetch");
+
+    // Show help not input options
+    if (cmd.get<bool>("help")) {
+        display_message();
+        cmd.printParams();
+        return 0;
+    }
+
+    ParameterSweep sweep;
+    if (!sweep.Load(sweepFile)) {
+        cout << "Invalid sweep file " << sweepFile << endl;
+        return 0;
+    }
+
+    string baseConfig;
+    if (!read_base_config(algorithm, baseConfig)) {
+        cout << "Unknown algorithm " << algorithm << endl;
+        return 0;
+    }
+
+    // Verify input name is a video file or directory with image files.
+    FrameReader *input_frame;
+    try {
+        input_frame = FrameReaderFactory::create_frame_reader(inputName);
+    } catch (...) {
+        cout << "Invalid file name "<< endl;
+        return 0;
+    }
+
+    int InitFrame = 0;
+    int EndFrame  = input_frame->getNFrames();
+    if (!rangeFrames.empty()) {
+        Point pf = stringToPoint(rangeFrames);
+        InitFrame = pf.x;
+        EndFrame  = pf.y;
+    }
+
+    // Each configuration gets a directory with its config file, the
+    // parameters it ran with and its scores
+    string sweepPath = algorithm + "_sweep";
+    std::vector<SweepRun> runs(sweep.Size());
+    int warmupFrames = 0;
+
+    for (size_t k = 0; k < sweep.Size(); ++k) {
+        stringstream dir;
+        dir << sweepPath << "/" << k;
+        create_directories(dir.str());
+
+        string config = dir.str() + "/config.xml";
+        std::ofstream out(config.c_str());
+        out << ParameterSweep::Apply(baseConfig, sweep[k]);
+        out.close();
+
+        SweepRun& run = runs[k];
+        run.name    = ParameterSweep::Name(sweep[k]);
+        run.seconds = 0.;
+        run.builder = create_builder(algorithm, config, input_frame, run);
+        warmupFrames = std::max(warmupFrames, run.warmupFrames);
+
+        out.open((dir.str() + "/parameters.txt").c_str());
+        out << run.builder->PrintParameters();
+        out.close();
+    }
+
+    // Ground truth is loaded once for all the configurations
+    GroundTruthEvaluator evaluator;
+    if (!groundTruth.empty() && !evaluator.Open(groundTruth, InitFrame, EndFrame))
+        cout << "No ground-truth images in " << groundTruth << endl;
+
+    // Decode image files ahead of the models
+    PrefetchFrameReader frames(input_frame, inputName, prefetchFrames);
+    WorkerPool pool(threads);
+
+    cout << "Sweep of " << runs.size() << " configurations on "
+         << pool.Threads() << " threads" << endl;
+
+    int cnt = 0;
+    if (seekRange && !rangeFrames.empty()) {
+        cnt = std::max(0, InitFrame - warmupFrames);
+        if (!frames.Seek(cnt))
+            cout << "Range starts after the end of the sequence" << endl;
+    }
+
+    Mat CurrentFrame;
+    std::vector<uint64_t> truth;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // main loop, every frame is decoded once and given to all the models
+    for(;;)
+    {
+        frames.getFrame(CurrentFrame);
+        if (CurrentFrame.empty()) break;
+
+        bool scored = evaluator.IsOpen() && cnt >= InitFrame && cnt <= EndFrame &&
+                      evaluator.GetTruth(cnt, CurrentFrame.size(), truth);
+
+        pool.run(runs.size(), [&](int k) {
+            SweepRun& run = runs[k];
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+            run.builder->Update(CurrentFrame, run.mask);
+            if (scored)
+                run.scores.push_back(GroundTruthEvaluator::Score(cnt, run.mask, truth, run.bits));
+
+            run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        });
+
+        cnt +=1;
+
+        if (cnt > EndFrame) break;
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    cout << "Time difference = " << std::chrono::duration_cast<std::chrono::seconds>(end - begin).count() << "[Sec]" << endl;
+
+    // Scores of every configuration, best F-measure reported
+    std::ofstream summary((sweepPath + "/summary.txt").c_str());
+    summary << "# config precision recall fmeasure seconds parameters" << "\n";
+
+    size_t best = 0;
+    double bestF = -1.;
+    for (size_t k = 0; k < runs.size(); ++k) {
+        SweepRun& run = runs[k];
+        FrameScore total = GroundTruthEvaluator::Total(run.scores);
+
+        stringstream dir;
+        dir << sweepPath << "/" << k;
+        if (evaluator.IsOpen())
+            GroundTruthEvaluator::WriteSummary(dir.str() + "/scores.txt",
+                                               run.builder->PrintParameters(), run.scores);
+
+        summary << k << " " << total.Precision() << " " << total.Recall() << " "
+                << total.FMeasure() << " " << run.seconds << " " << run.name << "\n";
+
+        if (total.FMeasure() > bestF) {
+            bestF = total.FMeasure();
+            best  = k;
+        }
+
+        delete run.builder;
+    }
+    summary.close();
+
+    if (evaluator.IsOpen() && !runs.empty())
+        cout << "Best fmeasure " << bestF << " with " << runs[best].name
+             << " (" << sweepPath << "/" << best << ")" << endl;
+
+    evaluator.Close();
+    delete input_frame;
+
+    return 0;
+}
@@ -0,0 +1,570 @@
+/*
+This file is part of BGSLibrary.
+
+BGSLibrary is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+BGSLibrary is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/****************************************************************************
+*
+* T2FGMM.cpp
+*
+* Purpose: Implementation of the T2 Fuzzy Gaussian Mixture Models (T2GMMs)
+* "Modeling of Dynamic Backgrounds by Type-2 Fuzzy Gaussians Mixture Models"
+* Author: Fida El Baf, Thierry Bouwmans, September 2008
+*
+* This code is based on code by Z. Zivkovic's written for his enhanced GMM
+* background subtraction algorithm:
+*
+* Zivkovic's code can be obtained at: www.zoranz.net
+******************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include "T2FGMM.h"
+#include "ParallelRows.h"
+
+using namespace Algorithms::BackgroundSubtraction;
+using namespace Algorithms::BackgroundSubtraction::BgsClient;
+
+static int compareT2FGMM(const void* _gmm1, const void* _gmm2)
+{
+  GMM gmm1 = *(GMM*)_gmm1;
+  GMM gmm2 = *(GMM*)_gmm2;
+
+  if(gmm1.significants < gmm2.significants)
+    return 1;
+  else if(gmm1.significants == gmm2.significants)
+    return 0;
+  else
+    return -1;
+}
+
+T2FGMM::T2FGMM()
+{
+  m_modes = NULL;
+  m_last_update = NULL;
+  m_stable = NULL;
+  m_update_count = 0;
+  m_learning = true;
+  m_background_valid = false;
+}
+
+T2FGMM::~T2FGMM()
+{
+  delete[] m_modes;
+  delete[] m_last_update;
+  delete[] m_stable;
+}
+
+GMM *T2FGMM::gmm()
+{
+  return m_modes;
+}
+
+unsigned char T2FGMM::modesPerPixel(int r, int c)
+{
+  return m_modes_per_pixel(r,c);
+}
+
+void T2FGMM::Initalize(const BgsParams& param)
+{
+  m_params = (T2FGMMParams&) param;
+
+  // Tbf - the threshold
+  m_bg_threshold = 0.75f;	// 1-cf from the paper
+
+  // Tgenerate - the threshold
+  m_variance = 36.0f;		// sigma for the new mode
+
+  // GMM for each pixel
+  m_modes = new GMM[m_params.Size()*m_params.MaxModes()];
+
+  // used modes per pixel
+  m_modes_per_pixel = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 1);
+
+  m_background = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
+
+  // Factor control for the T2FGMM-UM [0,3]
+  km = (float) m_params.KM();
+
+  // Factor control for the T2FGMM-UV [0.3,1]
+  kv = (float) m_params.KV();
+
+  // Book keeping of the sparse update
+  if(m_params.SparseUpdate())
+  {
+    m_reference = cvCreateImage(cvSize(m_params.Width(), m_params.Height()), IPL_DEPTH_8U, 3);
+    m_last_update = new unsigned int[m_params.Size()];
+    m_stable = new unsigned char[m_params.Size()];
+  }
+}
+
+RgbImage* T2FGMM::Background()
+{
+  if(!m_background_valid)
+  {
+    parallel_rows(m_params.Height(), [this](int first, int last) { BackgroundRows(first, last); },
+                  m_params.Threads());
+    m_background_valid = true;
+  }
+
+  return &m_background;
+}
+
+void T2FGMM::BackgroundRows(unsigned int first, unsigned int last)
+{
+  for(unsigned int r = first; r < last; ++r)
+  {
+    for(unsigned int c = 0; c < m_params.Width(); ++c)
+    {
+      long posPixel = (r*m_params.Width()+c)*m_params.MaxModes();
+
+      m_background(r,c,0) = (unsigned char) m_modes[posPixel].muR;
+      m_background(r,c,1) = (unsigned char) m_modes[posPixel].muG;
+      m_background(r,c,2) = (unsigned char) m_modes[posPixel].muB;
+    }
+  }
+}
+
+void T2FGMM::InitModel(const RgbImage& data)
+{
+  m_modes_per_pixel.Clear();
+  m_background_valid = false;
+
+  for(unsigned int i = 0; i < m_params.Size()*m_params.MaxModes(); ++i)
+  {
+    m_modes[i].weight = 0;
+    m_modes[i].variance = 0;
+    m_modes[i].muR = 0;
+    m_modes[i].muG = 0;
+    m_modes[i].muB = 0;
+    m_modes[i].significants = 0;
+  }
+
+  m_update_count = 0;
+
+  if(m_params.SparseUpdate())
+  {
+    for(unsigned int i = 0; i < m_params.Size(); ++i)
+    {
+      m_last_update[i] = 0;
+      m_stable[i] = 0;
+    }
+  }
+}
+
+void T2FGMM::Update(int frame_num, const RgbImage& data,  const BwImage& update_mask)
+{
+  // it doesn't make sense to have conditional updates in the GMM framework
+}
+
+void T2FGMM::SetLearning(bool learning, float alpha)
+{
+  m_learning = learning;
+  m_params.Alpha() = alpha;
+}
+
+bool T2FGMM::PixelChanged(const RgbPixel& pixel, const RgbPixel& reference)
+{
+  const int threshold = m_params.ChangeThreshold();
+
+  return std::abs((int)pixel(0) - (int)reference(0)) > threshold
+      || std::abs((int)pixel(1) - (int)reference(1)) > threshold
+      || std::abs((int)pixel(2) - (int)reference(2)) > threshold;
+}
+
+void T2FGMM::UpdateDominantMode(long posPixel, const RgbPixel& pixel)
+{
+  // The match branch of SubtractPixel() for mode 0, taken without the
+  // distance test: the pixel stayed within ChangeThreshold of the value
+  // that last matched it. Mean and variance follow the frame as in dense
+  // mode, the weights of the other modes are caught up later.
+  long pos = posPixel;
+
+  float weight = m_modes[pos].weight;
+  float var = m_modes[pos].variance;
+
+  float dR = m_modes[pos].muR - pixel(0);
+  float dG = m_modes[pos].muG - pixel(1);
+  float dB = m_modes[pos].muB - pixel(2);
+
+  float k = m_params.Alpha()/weight;
+  m_modes[pos].weight = (1 - m_params.Alpha())*weight + m_params.Alpha();
+  m_modes[pos].muR -= k*dR;
+  m_modes[pos].muG -= k*dG;
+  m_modes[pos].muB -= k*dB;
+
+  float sigmanew = var + k*((dR*dR + dG*dG + dB*dB) - var);
+  m_modes[pos].variance = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+  m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+}
+
+void T2FGMM::CatchUpPixel(long posPixel, unsigned char numModes, unsigned int skipped)
+{
+  // The dominant mode was updated on every skipped frame, the others only
+  // decayed by (1-alpha). Apply those 'skipped' steps in closed form.
+  float decay = std::pow(1 - m_params.Alpha(), (float)skipped);
+
+  for(int iModes = 1; iModes < numModes; ++iModes)
+  {
+    long pos = posPixel + iModes;
+
+    m_modes[pos].weight *= decay;
+    m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+  }
+}
+
+float T2FGMM::Distance(long pos, const RgbPixel& pixel)
+{
+  float var = m_modes[pos].variance;
+  float muR = m_modes[pos].muR;
+  float muG = m_modes[pos].muG;
+  float muB = m_modes[pos].muB;
+
+  float dR = muR - pixel(0);
+  float dG = muG - pixel(1);
+  float dB = muB - pixel(2);
+
+  float HR = 0;
+  float HG = 0;
+  float HB = 0;
+
+  // T2FGMM-UM
+  if(m_params.Type() == TYPE_T2FGMM_UM)
+  {
+    if((pixel(0) < muR - km*var) || (pixel(0) > muR + km*var))
+      HR = 2*km*fabs(dR)/var;
+    else
+      HR = dR*dR/(2*var*var) + km*fabs(dR)/var + km*km/2;
+
+    if((pixel(1) < muG - km*var) || (pixel(1) > muG + km*var))
+      HG = 2*km*fabs(dG)/var;
+    else
+      HG = dG*dG/(2*var*var) + km*fabs(dG)/var + km*km/2;
+
+    if((pixel(2) < muB - km*var) || (pixel(2) > muB + km*var))
+      HB = 2*km*fabs(dB)/var;
+    else
+      HB = dB*dB/(2*var*var) + km*fabs(dB)/var + km*km/2;
+  }
+
+  // T2FGMM-UV
+  if(m_params.Type() == TYPE_T2FGMM_UV)
+  {
+    HR = (1/(kv*kv) - kv*kv) * dR*dR/(2*var);
+    HG = (1/(kv*kv) - kv*kv) * dG*dG/(2*var);
+    HB = (1/(kv*kv) - kv*kv) * dB*dB/(2*var);
+  }
+
+  // calculate the squared distance
+  return HR*HR + HG*HG + HB*HB;
+}
+
+void T2FGMM::ClassifyPixel(long posPixel, const RgbPixel& pixel, unsigned char numModes, unsigned int skipped,
+                           unsigned char& low_threshold, unsigned char& high_threshold)
+{
+  // Same decision as SubtractPixel() but the model is left untouched. The
+  // weights of the modes after the first are taken as CatchUpPixel() would
+  // leave them after 'skipped' updates, the stored ones are caught up on
+  // the next learning frame.
+  bool bBackgroundLow = false;
+  bool bBackgroundHigh = false;
+
+  float decay = (skipped > 0) ? std::pow(1 - m_params.Alpha(), (float)skipped) : 1.f;
+
+  int backgroundGaussians = 0;
+  double sum = 0.0;
+  for(int i = 0; i < numModes; ++i)
+  {
+    if(sum < m_bg_threshold)
+    {
+      float weight = m_modes[posPixel+i].weight;
+      if(i > 0)
+        weight *= decay;
+
+      backgroundGaussians++;
+      sum += weight;
+    }
+    else
+      break;
+  }
+
+  for(int iModes = 0; iModes < numModes; iModes++)
+  {
+    long pos = posPixel + iModes;
+    float var = m_modes[pos].variance;
+    float dist = Distance(pos, pixel);
+
+    if(dist < m_params.HighThreshold()*var && iModes < backgroundGaussians)
+      bBackgroundHigh = true;
+
+    if(dist < m_params.LowThreshold()*var)
+    {
+      if(iModes < backgroundGaussians)
+        bBackgroundLow = true;
+      break;
+    }
+  }
+
+  low_threshold  = bBackgroundLow  ? BACKGROUND : FOREGROUND;
+  high_threshold = bBackgroundHigh ? BACKGROUND : FOREGROUND;
+}
+
+void T2FGMM::SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char& numModes,
+                           unsigned char& low_threshold, unsigned char& high_threshold, int& matchedMode)
+{
+  // calculate distances to the modes (+ sort???)
+  // here we need to go in descending order!!!
+  long pos;
+  bool bFitsPDF = false;
+  bool bBackgroundLow = false;
+  bool bBackgroundHigh = false;
+
+  float fOneMinAlpha = 1 - m_params.Alpha();
+  float totalWeight = 0.0f;
+
+  matchedMode = -1;
+
+  // calculate number of Gaussians to include in the background model
+  int backgroundGaussians = 0;
+  double sum = 0.0;
+  for(int i = 0; i < numModes; ++i)
+  {
+    if(sum < m_bg_threshold)
+    {
+      backgroundGaussians++;
+      sum += m_modes[posPixel+i].weight;
+    }
+    else
+      break;
+  }
+
+  // update all distributions and check for match with current pixel
+  for(int iModes = 0; iModes < numModes; iModes++)
+  {
+    pos = posPixel + iModes;
+    float weight = m_modes[pos].weight;
+
+    // fit not found yet
+    if(!bFitsPDF)
+    {
+      //check if it belongs to some of the modes
+      //calculate distance
+      float var = m_modes[pos].variance;
+      float muR = m_modes[pos].muR;
+      float muG = m_modes[pos].muG;
+      float muB = m_modes[pos].muB;
+
+      float dR = muR - pixel(0);
+      float dG = muG - pixel(1);
+      float dB = muB - pixel(2);
+
+      float dist = Distance(pos, pixel);
+
+      if(dist < m_params.HighThreshold()*var && iModes < backgroundGaussians)
+        bBackgroundHigh = true;
+
+      // a match occurs when the pixel is within sqrt(fThreshold) standard deviations of the distribution
+      if(dist < m_params.LowThreshold()*var)
+      {
+        bFitsPDF = true;
+        matchedMode = iModes;
+
+        // check if this Gaussian is part of the background model
+        if(iModes < backgroundGaussians)
+          bBackgroundLow = true;
+
+        //update distribution
+        float k = m_params.Alpha()/weight;
+        weight = fOneMinAlpha*weight + m_params.Alpha();
+        m_modes[pos].weight = weight;
+        m_modes[pos].muR = muR - k*(dR);
+        m_modes[pos].muG = muG - k*(dG);
+        m_modes[pos].muB = muB - k*(dB);
+
+        //limit the variance
+        float sigmanew = var + k*((dR*dR + dG*dG + dB*dB) - var);
+        m_modes[pos].variance = sigmanew < 4 ? 4 : sigmanew > 5*m_variance ? 5*m_variance : sigmanew;
+        m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+      }
+      else
+      {
+        weight = fOneMinAlpha*weight;
+        if(weight < 0.0)
+        {
+          weight = 0.0;
+          numModes--;
+        }
+
+        m_modes[pos].weight = weight;
+        m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+      }
+    }
+    else
+    {
+      weight = fOneMinAlpha*weight;
+      if(weight < 0.0)
+      {
+        weight = 0.0;
+        numModes--;
+      }
+      m_modes[pos].weight = weight;
+      m_modes[pos].significants = m_modes[pos].weight / sqrt(m_modes[pos].variance);
+    }
+
+    totalWeight += weight;
+  }
+
+  // renormalize weights so they add to one
+  double invTotalWeight = 1.0 / totalWeight;
+  for(int iLocal = 0; iLocal < numModes; iLocal++)
+  {
+    m_modes[posPixel + iLocal].weight *= (float)invTotalWeight;
+    m_modes[posPixel + iLocal].significants = m_modes[posPixel + iLocal].weight / sqrt(m_modes[posPixel + iLocal].variance);
+  }
+
+  // Sort significance values so they are in desending order.
+  qsort(&m_modes[posPixel], numModes, sizeof(GMM), compareT2FGMM);
+
+  // make new mode if needed and exit
+  if(!bFitsPDF)
+  {
+    if(numModes < m_params.MaxModes())
+      numModes++;
+    //else
+      // the weakest mode will be replaced
+
+    pos = posPixel + numModes - 1;
+
+    m_modes[pos].muR = pixel.ch[0];
+    m_modes[pos].muG = pixel.ch[1];
+    m_modes[pos].muB = pixel.ch[2];
+    m_modes[pos].variance = m_variance;
+    m_modes[pos].significants = 0;			// will be set below
+
+    if(numModes == 1)
+      m_modes[pos].weight = 1;
+    else
+      m_modes[pos].weight = m_params.Alpha();
+
+    //renormalize weights
+    int iLocal;
+    float sum = 0.0;
+    for(iLocal = 0; iLocal < numModes; iLocal++)
+      sum += m_modes[posPixel+ iLocal].weight;
+
+    double invSum = 1.0/sum;
+    for(iLocal = 0; iLocal < numModes; iLocal++)
+    {
+      m_modes[posPixel + iLocal].weight *= (float)invSum;
+      m_modes[posPixel + iLocal].significants = m_modes[posPixel + iLocal].weight / sqrt(m_modes[posPixel + iLocal].variance);
+    }
+  }
+
+  // Sort significance values so they are in desending order.
+  qsort(&(m_modes[posPixel]), numModes, sizeof(GMM), compareT2FGMM);
+
+  if(bBackgroundLow)
+    low_threshold = BACKGROUND;
+  else
+    low_threshold = FOREGROUND;
+
+  if(bBackgroundHigh)
+    high_threshold = BACKGROUND;
+  else
+    high_threshold = FOREGROUND;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//Input:
+//  data - a pointer to the data of a RGB image of the same size
+//Output:
+//  output - a pointer to the data of a gray value image of the same size
+//					(the memory should already be reserved)
+//					values: 255-foreground, 125-shadow, 0-background
+///////////////////////////////////////////////////////////////////////////////
+void T2FGMM::Subtract(int frame_num, const RgbImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask)
+{
+  unsigned char low_threshold, high_threshold;
+  long posPixel;
+  long pixel;
+  int matchedMode;
+
+  if(m_learning)
+  {
+    m_update_count++;
+    m_background_valid = false;
+  }
+
+  // update each pixel of the image
+  for(unsigned int r = 0; r < m_params.Height(); ++r)
+  {
+    for(unsigned int c = 0; c < m_params.Width(); ++c)
+    {
+      pixel = r*m_params.Width()+c;
+
+      // update model + background subtract
+      posPixel = pixel*m_params.MaxModes();
+
+      if(m_params.SparseUpdate())
+      {
+        // The reference is the value at the last evaluation rather than the
+        // previous frame, so slow drifts accumulate until they are noticed.
+        unsigned int skipped = m_update_count - m_last_update[pixel] - (m_learning ? 1 : 0);
+
+        if(m_stable[pixel] && (int)skipped + 1 < m_params.MaxSkipFrames()
+           && !PixelChanged(data(r,c), m_reference(r,c)))
+        {
+          if(m_learning)
+            UpdateDominantMode(posPixel, data(r,c));
+
+          low_threshold_mask(r,c) = BACKGROUND;
+          high_threshold_mask(r,c) = BACKGROUND;
+          continue;
+        }
+      }
+
+      if(!m_learning)
+      {
+        // updates skipped by a stable pixel since its last evaluation
+        unsigned int skipped = 0;
+        if(m_params.SparseUpdate() && m_stable[pixel])
+          skipped = m_update_count - m_last_update[pixel];
+
+        ClassifyPixel(posPixel, data(r,c), m_modes_per_pixel(r,c), skipped, low_threshold, high_threshold);
+        low_threshold_mask(r,c) = low_threshold;
+        high_threshold_mask(r,c) = high_threshold;
+        continue;
+      }
+
+      if(m_params.SparseUpdate())
+      {
+        unsigned int skipped = m_update_count - m_last_update[pixel] - 1;
+
+        if(skipped > 0 && m_stable[pixel])
+          CatchUpPixel(posPixel, m_modes_per_pixel(r,c), skipped);
+
+        m_last_update[pixel] = m_update_count;
+        m_reference(r,c) = data(r,c);
+      }
+
+      SubtractPixel(posPixel, data(r,c), m_modes_per_pixel(r,c), low_threshold, high_threshold, matchedMode);
+
+      if(m_params.SparseUpdate())
+        m_stable[pixel] = (matchedMode == 0 && low_threshold == BACKGROUND);
+
+      low_threshold_mask(r,c) = low_threshold;
+      high_threshold_mask(r,c) = high_threshold;
+    }
+  }
+}
@@ -38,97 +38,155 @@ namespace Algorithms
 {
   namespace BackgroundSubtraction
   {
-    const int TYPE_T2FGMM_UM = 0;
-    const int TYPE_T2FGMM_UV = 1;
-
-    // --- User adjustable parameters used by the T2F GMM BGS algorithm ---
-    class T2FGMMParams : public BgsParams
-    {
-    public:
-      float &LowThreshold() { return m_low_threshold; }
-      float &HighThreshold() { return m_high_threshold; }
-
-      float &Alpha() { return m_alpha; }
-      int &MaxModes() { return m_max_modes; }
-      int &Type() { return m_type; }
-      float &KM() { return m_km; }
-      float &KV() { return m_kv; }
-
-    private:
-      // Threshold on the squared dist. to decide when a sample is close to an existing 
-      // components. If it is not close to any a new component will be generated. 
-      // Smaller threshold values lead to more generated components and higher threshold values 
-      // lead to a small number of components but they can grow too large.
-      //
-      // It is usual easiest to think of these thresholds as being the number of variances away
-      // from the mean of a pixel before it is considered to be from the foreground.
-      float m_low_threshold;
-      float m_high_threshold;
-
-      // alpha - speed of update - if the time interval you want to average over is T
-      // set alpha=1/T. 
-      float m_alpha;
-
-      // Maximum number of modes (Gaussian components) that will be used per pixel
-      int m_max_modes;
-
-      // T2FGMM_UM / T2FGMM_UV
-      int m_type;
-
-      // Factor control for the T2FGMM-UM
-      float m_km;
-
-      // Factor control for the T2FGMM-UV
-      float m_kv;
-    };
-
-    // --- T2FGMM BGS algorithm ---
-    class T2FGMM : public Bgs
+    // This tree's T2FGMM. The bgs library linked in defines classes of the
+    // same names, the nested namespace keeps the two apart.
+    namespace BgsClient
     {
-    public:
-      T2FGMM();
-      ~T2FGMM();
-
-      void Initalize(const BgsParams& param);
-
-      void InitModel(const RgbImage& data);
-      void Subtract(int frame_num, const RgbImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-      void Update(int frame_num, const RgbImage& data, const BwImage& update_mask);
-
-      RgbImage* Background();
-
-    private:	
-      void SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char& numModes, unsigned char& lowThreshold, unsigned char& highThreshold);
-
-      // User adjustable parameters
-      T2FGMMParams m_params;
-
-      // Threshold when the component becomes significant enough to be included into
-      // the background model. It is the TB = 1-cf from the paper. So I use cf=0.1 => TB=0.9
-      // For alpha=0.001 it means that the mode should exist for approximately 105 frames before
-      // it is considered foreground
-      float m_bg_threshold; //1-cf from the paper
-
-      // Initial variance for the newly generated components. 
-      // It will will influence the speed of adaptation. A good guess should be made. 
-      // A simple way is to estimate the typical standard deviation from the images.
-      float m_variance;
-
-      // Dynamic array for the mixture of Gaussians
-      GMM* m_modes;
-
-      // Number of Gaussian components per pixel
-      BwImage m_modes_per_pixel;
-
-      // Current background model
-      RgbImage m_background;
-
-      // Factor control for the T2FGMM-UM
-      float km;
+      const int TYPE_T2FGMM_UM = 0;
+      const int TYPE_T2FGMM_UV = 1;
+
+      // --- User adjustable parameters used by the T2F GMM BGS algorithm ---
+      class T2FGMMParams : public BgsParams
+      {
+      public:
+        T2FGMMParams() : m_sparse_update(false), m_change_threshold(8), m_max_skip_frames(32), m_threads(0) {}
+
+        float &LowThreshold() { return m_low_threshold; }
+        float &HighThreshold() { return m_high_threshold; }
+
+        float &Alpha() { return m_alpha; }
+        int &MaxModes() { return m_max_modes; }
+        int &Type() { return m_type; }
+        float &KM() { return m_km; }
+        float &KV() { return m_kv; }
+
+        bool &SparseUpdate() { return m_sparse_update; }
+        int &ChangeThreshold() { return m_change_threshold; }
+        int &MaxSkipFrames() { return m_max_skip_frames; }
+
+        int &Threads() { return m_threads; }
+
+      private:
+        // Threshold on the squared dist. to decide when a sample is close to an existing 
+        // components. If it is not close to any a new component will be generated. 
+        // Smaller threshold values lead to more generated components and higher threshold values 
+        // lead to a small number of components but they can grow too large.
+        //
+        // It is usual easiest to think of these thresholds as being the number of variances away
+        // from the mean of a pixel before it is considered to be from the foreground.
+        float m_low_threshold;
+        float m_high_threshold;
+
+        // alpha - speed of update - if the time interval you want to average over is T
+        // set alpha=1/T. 
+        float m_alpha;
+
+        // Maximum number of modes (Gaussian components) that will be used per pixel
+        int m_max_modes;
+
+        // T2FGMM_UM / T2FGMM_UV
+        int m_type;
+
+        // Factor control for the T2FGMM-UM
+        float m_km;
+
+        // Factor control for the T2FGMM-UV
+        float m_kv;
+
+        // Sparse update: pixels that matched their dominant background mode and whose
+        // value moved less than m_change_threshold (per channel) since they were last
+        // evaluated are skipped. Every pixel is re-evaluated at least once every
+        // m_max_skip_frames updates so slow changes are still learnt. A skipped pixel
+        // is taken as background and its dominant mode is updated as on a match, so
+        // the model only departs from the dense one where that guess is wrong.
+        bool m_sparse_update;
+        int m_change_threshold;
+        int m_max_skip_frames;
+
+        // Threads of the per row loops, 0 uses all cores
+        int m_threads;
+      };
+
+      // --- T2FGMM BGS algorithm ---
+      class T2FGMM : public Bgs
+      {
+      public:
+        T2FGMM();
+        ~T2FGMM();
+
+        void Initalize(const BgsParams& param);
+
+        void InitModel(const RgbImage& data);
+        void Subtract(int frame_num, const RgbImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
+        void Update(int frame_num, const RgbImage& data, const BwImage& update_mask);
+
+        // Background image from the dominant mode of each pixel. It is computed
+        // on demand and cached until the model learns again.
+        RgbImage* Background();
+
+        GMM *gmm(void);
+        // Gaussians in use at pixel (r,c), its modes start at gmm()+(r*Width+c)*MaxModes
+        unsigned char modesPerPixel(int r, int c);
+
+        // Learning on: Subtract() classifies and updates the model with the given alpha.
+        // Learning off: Subtract() only classifies against the current model.
+        void SetLearning(bool learning, float alpha);
+
+      private:	
+        void BackgroundRows(unsigned int first, unsigned int last);
+        float Distance(long pos, const RgbPixel& pixel);
+        void SubtractPixel(long posPixel, const RgbPixel& pixel, unsigned char& numModes, unsigned char& lowThreshold, unsigned char& highThreshold, int& matchedMode);
+        void ClassifyPixel(long posPixel, const RgbPixel& pixel, unsigned char numModes, unsigned int skipped, unsigned char& lowThreshold, unsigned char& highThreshold);
+        bool PixelChanged(const RgbPixel& pixel, const RgbPixel& reference);
+        void UpdateDominantMode(long posPixel, const RgbPixel& pixel);
+        void CatchUpPixel(long posPixel, unsigned char numModes, unsigned int skipped);
+
+        // User adjustable parameters
+        T2FGMMParams m_params;
+
+        // Threshold when the component becomes significant enough to be included into
+        // the background model. It is the TB = 1-cf from the paper. So I use cf=0.1 => TB=0.9
+        // For alpha=0.001 it means that the mode should exist for approximately 105 frames before
+        // it is considered foreground
+        float m_bg_threshold; //1-cf from the paper
+
+        // Initial variance for the newly generated components. 
+        // It will will influence the speed of adaptation. A good guess should be made. 
+        // A simple way is to estimate the typical standard deviation from the images.
+        float m_variance;
+
+        // Dynamic array for the mixture of Gaussians
+        GMM* m_modes;
+
+        // Number of Gaussian components per pixel
+        BwImage m_modes_per_pixel;
+
+        // Current background model, valid while m_background_valid is set
+        RgbImage m_background;
+        bool m_background_valid;
+
+        // Factor control for the T2FGMM-UM
+        float km;
+
+        // Factor control for the T2FGMM-UV
+        float kv;
+
+        // Sparse update: pixel values at their last evaluation
+        RgbImage m_reference;
+
+        // Sparse update: update index of the last evaluation of each pixel
+        unsigned int* m_last_update;
 
-      // Factor control for the T2FGMM-UV
-      float kv;
-    };
+        // Sparse update: pixels whose last evaluation matched the dominant mode
+        unsigned char* m_stable;
+
+        // Number of model updates done so far
+        unsigned int m_update_count;
+
+        // Subtract() updates the model
+        bool m_learning;
+      };
+    }
   }
 }
 
@@ -31,6 +31,10 @@
 #include "DisplayImageUtils.h"
 
 #include "utils.h"
+#include "MaskArchive.h"
+#include "PrefetchFrameReader.h"
+#include "DriverOutput.h"
+#include "StageTimer.h"
 
 using namespace cv;
 using namespace std;
@@ -45,25 +49,16 @@ std::mutex mtx;
 struct MainParams {
     MainParams(string an, string in, string pp, string mr, 
                bool eg, bool sm, int r, int c, int f, int d)
-        :algName(an), fileName(in),pinPoint(pp), maskRange(mr),pin(0,0), 
+        :algName(an), fileName(in),pinPoint(pp), maskRange(mr),
          startFrameMask(0),endFrameMask(f),
          enableGui(eg), enableMask(sm), row(r), col(c), nframes(f), delay(d)
     {
-        // Define a pin point location on a display window
-        if ( !pinPoint.empty() ) {
-            pin = stringToPoint(pinPoint);
-            pin.x = pin.x > col ?  col: pin.x;
-            pin.y = pin.y > row ?  row: pin.y;
-        }
-
         if (!maskRange.empty()) {
             Point pf;
             pf = stringToPoint(maskRange);
             startFrameMask = pf.x;
             endFrameMask   = pf.y;
         }
-
-        maskPath    = algName + "_mask";
     };
     
    const string algName; // algorithm name
@@ -71,8 +66,6 @@ struct MainParams {
    string fileName; // video filename
    string pinPoint; //disply spot in video sequence
    string maskRange; // init and end mask frame to save
-   string maskPath;
-   Point  pin;
    int    startFrameMask;
    int    endFrameMask;
    bool   enableGui; // display video
@@ -89,8 +82,15 @@ const char* keys =
     "{ f | input     |       | Input video }"
     "{ m | mask      | true  | Save foreground masks}"
     "{ s | show      | true  | Show display window}"
-    "{ p | point     |       | Pin a red dot on the images for debugging,  e.g -p 250,300 }"
+    "{ p | point     |       | Pin red dots and trace pixels and model state to <alg>_points.trace, e.g -p 250,300;10,20 or a file of points }"
     "{ r | range     |       | Select a valid range save foreground masks}"
+    "{ o | output    | png   | Mask output: png files, or bits, rle or delta encoded archive <alg>_mask/masks.bgsm }"
+    "{ j | prefetch  | 8     | Frames decoded ahead on helper threads for image directories, 0 disables, off when the files do not match the FrameReader frame count }"
+    "{ t | stream    |       | Stream masks to a named pipe, or stdout }"
+    "{ e | encoding  | raw   | Stream encoding: raw or rle }"
+    "{ k | seek      | false | Start at the range start minus the algorithm WarmupFrames, stop at the range end }"
+    "{ g | groundtruth |     | Directory of ground-truth images, scores the range in-process to <alg>_scores.txt }"
+    "{ x | trace     |       | Write a Chrome trace of the frames, tiles and stages to this file, open it in Perfetto }"
     "{ h | help      | false | Print help message }"
 };
 
@@ -105,83 +105,32 @@ void display_message()
     cout << "------------------------------------------------------------" << endl <<endl;
 }
 
-void save_foreground_mask(const MainParams p, int cnt, InputArray im)
+// Model state of a pixel for the pixel trace, from the builder of its
+// tile. Tiles are numbered along the rows like ChunkImage splits the frame.
+struct TilePixelState
 {
-    // Save foreground images
-    if (p.enableMask && cnt >= p.startFrameMask && cnt <= p.endFrameMask) {
+    TilePixelState(vector<T2FGMM_UMBuilder*>& b, Size t, int cols)
+        : builders(b), tile(t), tilesPerRow(std::max(cols/t.width, 1)) {};
 
-        Mat Mask = im.getMat();
-
-        stringstream str;
-        vector<int> compression_params;
-        compression_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-        compression_params.push_back(9);
-
-        try {
-            str << p.maskPath << "/" <<  cnt << ".png";
-            imwrite(str.str(), Mask, compression_params);
-        }
-        catch (runtime_error& ex) {
-            cout << "Exception converting image to PNG format: " << ex.what() << endl;
-        }
-        catch (...) {
-            cout << "Unknown Exception converting image to PNG format: " << endl;
-        }
-    }
-}
- 
-void save_pixel_values_tofile(const MainParams p, InputArray im, std::ofstream& file)
-{
-    // Save pixel information in a local file
-    if (!p.pinPoint.empty()) {
+    int    PixelStateSize()   { return builders[0]->PixelStateSize(); };
+    string PixelStateLayout() { return builders[0]->PixelStateLayout(); };
 
-        Mat Img = im.getMat();
-
-        stringstream msgPoint;
-        msgPoint  << (int)Img.at<Vec3b>(p.pin)[0] << " "
-                  << (int)Img.at<Vec3b>(p.pin)[1] << " "
-                  << (int)Img.at<Vec3b>(p.pin)[2] ;
-
-        //define outfile to save BGR pixel values
-        if (!file.is_open()){
-            stringstream name("");
-            name << "point_" << p.pin.x << "_" << p.pin.y << ".txt";
-            file.open(name.str().c_str());
-        }
-        file<< msgPoint.str() << endl;
-    }
-}
- 
-
-void setup_foreground_directory(MainParams &p)
-{
-    // Create foreground directory and numbered sub-directories (alg_mask/0, alg_mask/1, ...)
-    if (p.enableMask) 
+    void PixelState(Point pin, float* state)
     {
+        int i = std::min((pin.y/tile.height)*tilesPerRow + pin.x/tile.width,
+                         (int)builders.size() - 1);
+        Point local(std::min(pin.x - (i % tilesPerRow)*tile.width,  tile.width - 1),
+                    std::min(pin.y - (i / tilesPerRow)*tile.height, tile.height - 1));
 
-        // Setup algorithm name
-        string algNameLowercase(ALGORITHM_NAME);
-        transform(ALGORITHM_NAME.begin(), 
-                  ALGORITHM_NAME.end(), 
-                  algNameLowercase.begin(),::tolower);
-
-        // Prapare mask directory
-        string _foreground_path    = algNameLowercase + "_mask";
-
-        create_foreground_directory(_foreground_path);
-
-        std::ofstream outfile;
-        stringstream param;
+        builders[i]->PixelState(local, state);
+    };
 
-        param << _foreground_path << "/parameters.txt" ;
-        outfile.open(param.str().c_str());
-        outfile << p.configParams;
-        outfile.close();
-        p.maskPath = _foreground_path;
-    }
-}
+    vector<T2FGMM_UMBuilder*>& builders;
+    Size tile;
+    int  tilesPerRow;
+};
 
-bool display_images(MainParams &p, int cnt, InputArray im, InputArray fg)
+bool display_images(MainParams &p, const vector<Point>& pins, int cnt, InputArray im, InputArray fg)
 {
 
     if (p.enableGui) {
@@ -190,10 +139,10 @@ bool display_images(MainParams &p, int cnt, InputArray im, InputArray fg)
         Mat Mask = fg.getMat();
         Mat Image;
     
-        // Insert pin on the Window.
-        if (!p.pinPoint.empty()){
-            circle(Img,  p.pin,8,Scalar(0,0,254),-1,8);
-            circle(Mask, p.pin,8,Scalar(0,0,254),-1,8);
+        // Insert pins on the Window.
+        for (size_t k = 0; k < pins.size(); ++k) {
+            circle(Img,  pins[k],8,Scalar(0,0,254),-1,8);
+            circle(Mask, pins[k],8,Scalar(0,0,254),-1,8);
         }
     
         // Invert color of Mask from black to white
@@ -240,8 +189,12 @@ bool display_images(MainParams &p, int cnt, InputArray im, InputArray fg)
 }
 
 
-void process_images(BGSSystem* method, InputArray Img, OutputArray Mask)
+void process_images(BGSSystem* method, InputArray Img, OutputArray Mask, int cnt, int tile)
 {
+    static const int traceTile   = ChromeTrace::Name("tile");
+    static const int traceDriver = ChromeTrace::Name("driver");
+    StageTimer::Clock::time_point begin = StageTimer::Clock::now();
+
     Mat CurrentFrame = Img.getMat();
 
     //mtx.lock();
@@ -250,6 +203,7 @@ void process_images(BGSSystem* method, InputArray Img, OutputArray Mask)
 
     method->updateAlgorithm(CurrentFrame, Mask);
 
+    ChromeTrace::Span(traceTile, traceDriver, begin, StageTimer::Clock::now(), cnt, tile);
 
 }
 
@@ -271,6 +225,13 @@ int main( int argc, char** argv )
     const string pinPoint                 = cmd.get<string>("point");
     const bool saveForegroundMask         = cmd.get<bool>("mask");
     const string  rangeSaveForegroundMask = cmd.get<string>("range");
+    const string maskOutput               = cmd.get<string>("output");
+    const int prefetchFrames              = cmd.get<int>("prefetch");
+    const string maskStream               = cmd.get<string>("stream");
+    const string streamEncoding           = cmd.get<string>("encoding");
+    const bool seekRange                  = cmd.get<bool>("seek");
+    const string groundTruth              = cmd.get<string>("groundtruth");
+    const string traceFile                = cmd.get<string>("trace");
     
     // Show help not input options
     if (cmd.get<bool>("help")) {
@@ -278,6 +239,19 @@ int main( int argc, char** argv )
         cmd.printParams();
         return 0;
     }
+
+    // Masks go to png files or to an archive with one of the encodings
+    uint32_t encoding;
+    int keyframes;
+    const bool archiveOutput = mask_encoding_from_name(maskOutput, encoding, keyframes);
+    if (!archiveOutput && maskOutput != "png") {
+        cout << "Unknown mask output " << maskOutput << ", use png, bits, rle or delta" << endl;
+        return 0;
+    }
+
+    // Timeline of the frames, tiles and stages, written at exit
+    if (!traceFile.empty())
+        ChromeTrace::Enable(traceFile);
     
     // Verify input name is a video file or directory with image files.
     FrameReader *input_frame;
@@ -287,6 +261,14 @@ int main( int argc, char** argv )
         cout << "Invalid file name "<< endl;
         return 0;
     }
+
+    // Send masks to another process, messages go to stderr when the
+    // masks take stdout
+    DriverOutput output(algNameLowercase);
+    output.OpenStream(maskStream, streamEncoding);
+
+    // Decode image files ahead of the model
+    PrefetchFrameReader frames(input_frame, fileName, prefetchFrames);
  
     MainParams params(
             algNameLowercase, 
@@ -309,31 +291,53 @@ int main( int argc, char** argv )
 
 
     vector<BGSSystem*> methods;
+    vector<T2FGMM_UMBuilder*> builders;
+    int warmupFrames = 0;
     for (int i=0; i<NUM_THREADS; i++) {
         // Algorithm Instantiate
         BGSSystem* bgs = new BGSSystem();
-        bgs->setAlgorithm(new T2FGMM_UMBuilder(chunk.getSubImgCol(),
-                                               chunk.getSubImgRow(),
-                                               input_frame->getNChannels()   ));
+        T2FGMM_UMBuilder* builder = new T2FGMM_UMBuilder(chunk.getSubImgCol(),
+                                                         chunk.getSubImgRow(),
+                                                         input_frame->getNChannels());
+        bgs->setAlgorithm(builder);
         bgs->setName(ALGORITHM_NAME);
         bgs->loadConfigParameters();
         bgs->initializeAlgorithm();
  
         methods.push_back(bgs);
-        if (i == 0 )
+        builders.push_back(builder);
+        if (i == 0 ) {
             params.configParams = bgs->getConfigurationParameters();
+            warmupFrames = builder->WarmupFrames();
+        }
     }
 
     // Create foreground directory and numbered sub-directories (alg_mask/0, alg_mask/1, ...)
-    setup_foreground_directory(params);
+    output.SetRange(params.startFrameMask, params.endFrameMask);
+    if (params.enableMask)
+        output.OpenMasks(params.configParams, Size(params.col, params.row),
+                         archiveOutput, encoding, keyframes);
+
+    // Score the masks while they are computed instead of reading them back
+    output.OpenGroundTruth(groundTruth);
+
+    // Define the points pinned on a display window and traced
+    output.SetPins(pinPoint, Size(params.col, params.row));
+    TilePixelState tiles(builders, Size(chunk.getSubImgCol(), chunk.getSubImgRow()), params.col);
 
-    std::ofstream point_file;
     Mat CurrentFrame;
     Mat Foreground;
     Mat Image;
    
     int cnt = 0;
 
+    // Jump to the range, the model only sees its warm-up frames before it
+    if (seekRange && !rangeSaveForegroundMask.empty()) {
+        cnt = std::max(0, params.startFrameMask - warmupFrames);
+        if (!frames.Seek(cnt))
+            cout << "Range starts after the end of the sequence" << endl;
+    }
+
     std::vector<Mat> subImgs;
     std::vector<Mat> subMask;
     std::vector<std::thread> t;
@@ -344,21 +348,42 @@ int main( int argc, char** argv )
         subMask.push_back(Mat(size,CV_8UC1,Scalar::all(0)));
     }
 
+    // Time of each step of a frame, reported at the end with the stages
+    // of the tile models
+    StageTimer timing("driver");
+    const int stageDecode  = timing.Stage("decode");
+    const int stageSplit   = timing.Stage("split");
+    const int stageSpawn   = timing.Stage("spawn");
+    const int stageJoin    = timing.Stage("join");
+    const int stageMerge   = timing.Stage("merge");
+    const int stageWrite   = timing.Stage("write");
+    const int stageStream  = timing.Stage("stream");
+    const int stageScore   = timing.Stage("score");
+    const int stageTrace   = timing.Stage("pixels");
+    const int stageDisplay = timing.Stage("display");
+    const int traceFrame   = ChromeTrace::Name("frame");
+    const int traceDriver  = ChromeTrace::Name("driver");
+
     std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
     // main loop
     for(;;)
     {
+        StageTimer::Clock::time_point step = StageTimer::Clock::now();
+        StageTimer::Clock::time_point frameBegin = step;
 
         Foreground = Scalar::all(0);
-        input_frame->getFrame(CurrentFrame);
+        frames.getFrame(CurrentFrame);
         if (CurrentFrame.empty()) break;
+        step = timing.Mark(stageDecode, step);
 
         chunk(CurrentFrame,subImgs);
+        step = timing.Mark(stageSplit, step);
 
         //Launch a group of threads
         for (int i = 0; i < NUM_THREADS; ++i) 
-            t.push_back(std::thread(process_images,methods[i], subImgs[i], subMask[i]));
+            t.push_back(std::thread(process_images,methods[i], subImgs[i], subMask[i], cnt, i));
+        step = timing.Mark(stageSpawn, step);
 
         //Join the threads with the main thread
         for(auto &e : t){
@@ -366,20 +391,32 @@ int main( int argc, char** argv )
         }
 
         t.clear();
+        step = timing.Mark(stageJoin, step);
 
 
         chunk.mergeImages(subMask,Foreground);
-        save_foreground_mask(params,cnt, Foreground);
+        step = timing.Mark(stageMerge, step);
+        output.WriteMask(cnt, Foreground);
+        step = timing.Mark(stageWrite, step);
 
-        save_pixel_values_tofile(params, CurrentFrame, point_file);
+        output.StreamMask(cnt, Foreground);
+        step = timing.Mark(stageStream, step);
 
-        if (!display_images(params, cnt, CurrentFrame, Foreground)) break;
+        output.ScoreMask(cnt, Foreground);
+        step = timing.Mark(stageScore, step);
+
+        output.TracePixels(cnt, CurrentFrame, Foreground, tiles);
+        step = timing.Mark(stageTrace, step);
+
+        if (!display_images(params, output.Pins(), cnt, CurrentFrame, Foreground)) break;
+        step = timing.Mark(stageDisplay, step);
+        ChromeTrace::Span(traceFrame, traceDriver, frameBegin, step, cnt);
 
         cnt +=1;
 
         subImgs.clear();
 
-        if (!showWindow && cnt > params.endFrameMask) break;
+        if ((!showWindow || seekRange) && cnt > params.endFrameMask) break;
         
     }
     
@@ -388,11 +425,25 @@ int main( int argc, char** argv )
     std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() <<std::endl;
     std::cout << "Time difference = " << std::chrono::duration_cast<std::chrono::nanoseconds> (end - begin).count() <<std::endl;
     
+    // Where the time of a frame went, driver steps then the model stages
+    // of all the tiles
+    StageTimer models;
+    for (size_t i = 0; i < builders.size(); ++i)
+        models.Merge(builders[i]->Timing());
+    cout << timing.Report(ALGORITHM_NAME + " driver");
+    cout << models.Report(ALGORITHM_NAME + " model, all tiles");
+
+    // Scores with the parameters that produced them
+    output.Summary(params.configParams);
+
+    if (ChromeTrace::Enabled() && !ChromeTrace::Write())
+        cout << "Could not write trace " << traceFile << endl;
+
     for (int i=0; i<NUM_THREADS; i++) {
         delete methods[i];
     }
     delete input_frame;
-    if (point_file.is_open()) point_file.close();
+    output.Close();
 
     return 0;
 }
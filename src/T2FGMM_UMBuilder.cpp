@@ -14,6 +14,8 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
+#include <cmath>
+#include <algorithm>
 #include "T2FGMM_UMBuilder.h"
 
 
@@ -24,6 +26,11 @@ const double       T2FGMM_UMBuilder::DefaultAlpha       = 0.001;
 const float        T2FGMM_UMBuilder::DefaultKm          = 1.5f;
 const float        T2FGMM_UMBuilder::DefaultKv          = 0.6f; 
 const int          T2FGMM_UMBuilder::DefaultGaussians   = 3;
+const int          T2FGMM_UMBuilder::DefaultModelUpdateInterval = 1;
+const bool         T2FGMM_UMBuilder::DefaultSparseUpdate    = false;
+const int          T2FGMM_UMBuilder::DefaultChangeThreshold = 8;
+const int          T2FGMM_UMBuilder::DefaultMaxSkipFrames   = 32;
+const int          T2FGMM_UMBuilder::DefaultWarmupFrames    = 200;
 
 T2FGMM_UMBuilder::T2FGMM_UMBuilder()
 {
@@ -33,6 +40,8 @@ T2FGMM_UMBuilder::T2FGMM_UMBuilder()
     nchannels = 0;
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
     model_frame.ReleaseMemory(false);
 
 }
@@ -45,6 +54,8 @@ T2FGMM_UMBuilder::T2FGMM_UMBuilder(int _col, int _row, int _nchannels)
     nchannels = _nchannels;
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
     model_frame.ReleaseMemory(false);
 
 }
@@ -59,6 +70,8 @@ T2FGMM_UMBuilder::T2FGMM_UMBuilder(Size _size, int _type)
     nchannels = CV_MAT_CN(frameType);
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
     model_frame.ReleaseMemory(false);
 }
 
@@ -84,11 +97,19 @@ void T2FGMM_UMBuilder::Initialization()
         modelParams.SetFrameSize(cols, rows);
         modelParams.LowThreshold()  = threshold;
         modelParams.HighThreshold() = 2*modelParams.LowThreshold();
-        modelParams.Alpha()         = alpha;
+        // The model is updated every modelUpdateInterval frames, compensate
+        // alpha so the adaptation time (in frames) stays the same.
+        updateAlpha = 1. - std::pow(1. - alpha, modelUpdateInterval);
+
+        modelParams.Alpha()         = updateAlpha;
         modelParams.MaxModes()      = gaussians;
         modelParams.Type()          = TYPE_T2FGMM_UM;
         modelParams.KM()            = km; // Factor control for the T2FGMM-UM [0,3] default: 1.5
         modelParams.KV()            = kv; // Factor control for the T2FGMM-UV [0.3,1] default: 0.6
+        modelParams.SparseUpdate()    = sparseUpdate;
+        modelParams.ChangeThreshold() = changeThreshold;
+        modelParams.MaxSkipFrames()   = maxSkipFrames;
+        modelParams.Threads()         = threads;
 
         model = new T2FGMM();
         model->Initalize(modelParams);
@@ -104,11 +125,9 @@ void T2FGMM_UMBuilder::Initialization()
 
 void T2FGMM_UMBuilder::GetBackground(OutputArray image) 
 {
-    /*
-    Mat img_background;
-    model->getBackgroundImage(img_background);
+    // computed by the model only when requested
+    Mat img_background(model->Background()->Ptr());
     img_background.copyTo(image);
-    */
 }
 
 void T2FGMM_UMBuilder::GetForeground(OutputArray mask) 
@@ -118,6 +137,8 @@ void T2FGMM_UMBuilder::GetForeground(OutputArray mask)
 
 void T2FGMM_UMBuilder::Update(InputArray frame, OutputArray mask) 
 {
+    StageTimer::Clock::time_point t = StageTimer::Clock::now();
+    StageTimer::Clock::time_point begin = t;
 
     Mat Image = frame.getMat();
     //Mat Foreground(Image.size(),CV_8U,Scalar::all(0));
@@ -126,10 +147,14 @@ void T2FGMM_UMBuilder::Update(InputArray frame, OutputArray mask)
     model_frame = input_frame;
 
 
+    // Subtract every frame, learn only every modelUpdateInterval frames
+    model->SetLearning(frame_counter % modelUpdateInterval == 0, updateAlpha);
     model->Subtract(frame_counter , model_frame, lowThresholdMask, highThresholdMask);
+    t = timing.Mark(stageSubtract, t);
     
     lowThresholdMask.Clear();
     model->Update(frame_counter, model_frame, lowThresholdMask);
+    timing.Mark(stageUpdate, t);
 
     Mat Foreground(highThresholdMask.Ptr());
 
@@ -138,6 +163,9 @@ void T2FGMM_UMBuilder::Update(InputArray frame, OutputArray mask)
 
     frame_counter += 1;
 
+    timing.Mark(stageFrame, begin);
+    duration = timing.Last(stageFrame);
+
 
 
 
@@ -173,6 +201,11 @@ void T2FGMM_UMBuilder::loadDefaultParameters()
     km          = DefaultKm         ;
     kv          = DefaultKv         ; 
     gaussians   = DefaultGaussians  ;
+    modelUpdateInterval = DefaultModelUpdateInterval;
+    sparseUpdate    = DefaultSparseUpdate;
+    changeThreshold = DefaultChangeThreshold;
+    maxSkipFrames   = DefaultMaxSkipFrames;
+    warmupFrames    = DefaultWarmupFrames;
 }
 
 string T2FGMM_UMBuilder::PrintParameters()
@@ -185,7 +218,12 @@ string T2FGMM_UMBuilder::PrintParameters()
     << "Alpha="        << alpha       << " "
     << "Km="           << km          << " "
     << "Kv="           << kv          << " " 
-    << "Gaussians="    << gaussians   ;
+    << "Gaussians="    << gaussians   << " "
+    << "ModelUpdateInterval=" << modelUpdateInterval << " "
+    << "SparseUpdate=" << sparseUpdate << " "
+    << "ChangeThreshold=" << changeThreshold << " "
+    << "MaxSkipFrames=" << maxSkipFrames << " "
+    << "WarmupFrames=" << warmupFrames;
     return str.str();
 
 }
@@ -202,16 +240,7 @@ void T2FGMM_UMBuilder::LoadConfigParameters()
 
     if ( exists(filename) && is_regular_file(filename) ) {
         
-        FileStorage fs(filename, FileStorage::READ);
-
-        frameNumber = (int)fs["FrameNumber"];
-        threshold   = (double)fs["Threshold"];
-        alpha       = (double)fs["Alpha"];
-        km          = (float)fs["Km"];
-        kv          = (float)fs["Kv"];
-        gaussians   = (int)fs["Gaussians"];
-
-        fs.release();
+        LoadConfigParameters(filename);
     }
     else {
         path p("config");
@@ -226,6 +255,11 @@ void T2FGMM_UMBuilder::LoadConfigParameters()
         fs << "Km"          << km         ; 
         fs << "Kv"          << kv         ; 
         fs << "Gaussians"   << (int)gaussians  ; 
+        fs << "ModelUpdateInterval" << modelUpdateInterval; 
+        fs << "SparseUpdate"    << (int)sparseUpdate; 
+        fs << "ChangeThreshold" << changeThreshold  ; 
+        fs << "MaxSkipFrames"   << maxSkipFrames    ; 
+        fs << "WarmupFrames"    << warmupFrames     ; 
 
         fs.release();
 
@@ -233,6 +267,41 @@ void T2FGMM_UMBuilder::LoadConfigParameters()
 
 }
 
+void T2FGMM_UMBuilder::LoadConfigParameters(const string& filename)
+{
+    FileStorage fs(filename, FileStorage::READ);
+
+    frameNumber = (int)fs["FrameNumber"];
+    threshold   = (double)fs["Threshold"];
+    alpha       = (double)fs["Alpha"];
+    km          = (float)fs["Km"];
+    kv          = (float)fs["Kv"];
+    gaussians   = (int)fs["Gaussians"];
+
+    // Optional entries, older config files do not have them
+    if (!fs["ModelUpdateInterval"].empty())
+        modelUpdateInterval = std::max(1, (int)fs["ModelUpdateInterval"]);
+    if (!fs["SparseUpdate"].empty())
+        sparseUpdate    = (int)fs["SparseUpdate"];
+    if (!fs["ChangeThreshold"].empty())
+        changeThreshold = (int)fs["ChangeThreshold"];
+    if (!fs["MaxSkipFrames"].empty())
+        maxSkipFrames   = (int)fs["MaxSkipFrames"];
+    if (!fs["WarmupFrames"].empty())
+        warmupFrames    = std::max(0, (int)fs["WarmupFrames"]);
+
+    fs.release();
+}
+
+
+void T2FGMM_UMBuilder::setupTiming()
+{
+    duration      = 0.;
+    timing        = StageTimer("model");
+    stageSubtract = timing.Stage("subtract");
+    stageUpdate   = timing.Stage("update");
+    stageFrame    = timing.Stage("frame");
+}
 
 string T2FGMM_UMBuilder::ElapsedTimeAsString()
 {
@@ -242,4 +311,34 @@ string T2FGMM_UMBuilder::ElapsedTimeAsString()
 }
 
 
+int T2FGMM_UMBuilder::PixelStateSize()
+{
+    return 1 + 5*gaussians;
+}
 
+string T2FGMM_UMBuilder::PixelStateLayout()
+{
+    std::stringstream str;
+    str << "modes,{weight,variance,muR,muG,muB}x" << gaussians;
+    return str.str();
+}
+
+void T2FGMM_UMBuilder::PixelState(Point p, float* state)
+{
+    std::fill(state, state + PixelStateSize(), 0.f);
+    if (!has_been_initialized)
+        return;
+
+    // unused modes are left at zero
+    const GMM* modes = model->gmm() + (p.y*cols + p.x)*gaussians;
+    int n = model->modesPerPixel(p.y, p.x);
+    state[0] = n;
+    for (int k = 0; k < n; ++k) {
+        float* s = state + 1 + 5*k;
+        s[0] = modes[k].weight;
+        s[1] = modes[k].variance;
+        s[2] = modes[k].muR;
+        s[3] = modes[k].muG;
+        s[4] = modes[k].muB;
+    }
+}
@@ -15,17 +15,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
 
-#ifndef _IMBS_ALGORITHM_H
-#define _IMBS_ALGORITHM_H
+#ifndef _T2FGMM_UM_BUILDER_H
+#define _T2FGMM_UM_BUILDER_H
 
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include "IBGSAlgorithm.h"
+#include "StageTimer.h"
 #include "T2FGMM.h"
 
 using namespace cv;
 using namespace boost::filesystem;
 using namespace Algorithms::BackgroundSubtraction;
+using namespace Algorithms::BackgroundSubtraction::BgsClient;
 
 
 class T2FGMM_UMBuilder: public IBGSAlgorithm
@@ -41,6 +43,8 @@ public:
     ~T2FGMM_UMBuilder();
     void SetAlgorithmParameters()  {};
     void LoadConfigParameters();
+    // Parameters of another config file, e.g. one configuration of a sweep
+    void LoadConfigParameters(const string& filename);
     void SaveConfigParameters() {};
     void Initialization();
     void GetBackground(OutputArray);
@@ -50,11 +54,31 @@ public:
     void SaveModel() {};
     string PrintParameters();
     const string Name() {return AlgorithmName; };
+    // Milliseconds of the last Update(), Timing() has each of its stages
     string ElapsedTimeAsString();
     double ElapsedTime(){ return duration; };
+    const StageTimer& Timing() const { return timing; };
+
+    // Frames the model needs before its masks are worth evaluating, the
+    // drivers start that many frames before the --range start with --seek
+    int WarmupFrames() const { return warmupFrames; };
+
+    // ModelUpdateInterval without a config file, call before Initialization()
+    void SetModelUpdateInterval(int k) { modelUpdateInterval = std::max(1, k); };
+
+    // Threads of the model's per row loops, 0 (the default) uses all
+    // cores. Call before Initialization().
+    void SetThreads(int n) { threads = std::max(0, n); };
+
+    // Model state of a pixel for the pixel trace (PixelTrace.h), call
+    // after the first Update(). PixelStateLayout() names the values.
+    int    PixelStateSize();
+    string PixelStateLayout();
+    void   PixelState(Point p, float* state);
 
 private:
     void loadDefaultParameters();
+    void setupTiming();
 
     int rows;
     int cols;
@@ -64,6 +88,8 @@ private:
     Size frameSize;
     int  frameType;
     double duration;
+    StageTimer timing;
+    int  stageSubtract, stageUpdate, stageFrame;
 
     //unsigned char *FilterFGImage;
     static const string AlgorithmName;
@@ -87,6 +113,13 @@ private:
     float        km;
     float        kv;
     int          gaussians;
+    int          modelUpdateInterval;
+    int          threads;
+    double       updateAlpha;
+    bool         sparseUpdate;
+    int          changeThreshold;
+    int          maxSkipFrames;
+    int          warmupFrames;
 
     static const long         DefaultFrameNumber;
     static const double       DefaultThreshold;
@@ -94,6 +127,11 @@ private:
     static const float        DefaultKm;
     static const float        DefaultKv;
     static const int          DefaultGaussians;
+    static const int          DefaultModelUpdateInterval;
+    static const bool         DefaultSparseUpdate;
+    static const int          DefaultChangeThreshold;
+    static const int          DefaultMaxSkipFrames;
+    static const int          DefaultWarmupFrames;
 
 };
 
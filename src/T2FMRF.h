@@ -31,6 +31,8 @@ along with BGSLibrary.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef T2F_MRF_
 #define T2F_MRF_
 
+#include <algorithm>
+#include <vector>
 #include "Bgs.h"
 #include "GrimsonGMM.h"
 
@@ -38,126 +40,208 @@ namespace Algorithms
 {
   namespace BackgroundSubtraction
   {
-    const int TYPE_T2FMRF_UM = 0;
-    const int TYPE_T2FMRF_UV = 1;
-
-    enum HiddenState {background, foreground};
-
-    typedef struct HMMState 
-    {
-      float T;
-      //Hidden State
-      HiddenState State;
-      //transition probability
-      float Ab2b;
-      float Ab2f;
-      float Af2f;
-      float Af2b;
-    } HMM;
-
-    //typedef struct GMMGaussian
-    //{
-    //  float variance;
-    //  float muR;
-    //  float muG;
-    //  float muB;
-    //  float weight;
-    //  float significants; // this is equal to weight / standard deviation and is used to
-    //  // determine which Gaussians should be part of the background model
-    //} GMM;
-
-    // --- User adjustable parameters used by the T2F GMM BGS algorithm ---
-    class T2FMRFParams : public BgsParams
-    {
-    public:
-      float &LowThreshold() { return m_low_threshold; }
-      float &HighThreshold() { return m_high_threshold; }
-
-      float &Alpha() { return m_alpha; }
-      int &MaxModes() { return m_max_modes; }
-      int &Type() { return m_type; }
-      float &KM() { return m_km; }
-      float &KV() { return m_kv; }
-
-    private:
-      // Threshold on the squared dist. to decide when a sample is close to an existing 
-      // components. If it is not close to any a new component will be generated. 
-      // Smaller threshold values lead to more generated components and higher threshold values 
-      // lead to a small number of components but they can grow too large.
-      //
-      // It is usual easiest to think of these thresholds as being the number of variances away
-      // from the mean of a pixel before it is considered to be from the foreground.
-      float m_low_threshold;
-      float m_high_threshold;
-
-      // alpha - speed of update - if the time interval you want to average over is T
-      // set alpha=1/T. 
-      float m_alpha;
-
-      // Maximum number of modes (Gaussian components) that will be used per pixel
-      int m_max_modes;
-
-      // T2FMRF_UM / T2FMRF_UV
-      int m_type;
-
-      // Factor control for the T2FMRF-UM
-      float m_km;
-
-      // Factor control for the T2FMRF-UV
-      float m_kv;
-    };
-
-    // --- T2FGMM BGS algorithm ---
-    class T2FMRF : public Bgs
+    // This tree's T2FMRF. The bgs library linked in defines classes of the
+    // same names, the nested namespace keeps the two apart.
+    namespace BgsClient
     {
-    public:
-      T2FMRF();
-      ~T2FMRF();
-
-      void Initalize(const BgsParams& param);
-      void InitModel(const RgbImage& data);
-      void Subtract(int frame_num, const RgbImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
-      void Update(int frame_num, const RgbImage& data, const BwImage& update_mask);
-
-      RgbImage* Background();
-
-      GMM *gmm(void);
-      HMM *hmm(void);
-
-    private:	
-      void SubtractPixel(long posPixel, long posGMode, const RgbPixel& pixel, unsigned char& numModes, unsigned char& lowThreshold, unsigned char& highThreshold);
-
-      // User adjustable parameters
-      T2FMRFParams m_params;
-
-      // Threshold when the component becomes significant enough to be included into
-      // the background model. It is the TB = 1-cf from the paper. So I use cf=0.1 => TB=0.9
-      // For alpha=0.001 it means that the mode should exist for approximately 105 frames before
-      // it is considered foreground
-      float m_bg_threshold; //1-cf from the paper
-
-      // Initial variance for the newly generated components. 
-      // It will will influence the speed of adaptation. A good guess should be made. 
-      // A simple way is to estimate the typical standard deviation from the images.
-      float m_variance;
-
-      // Dynamic array for the mixture of Gaussians
-      GMM* m_modes;
-
-      //Dynamic array for the hidden state
-      HMM* m_state;
-
-      // Number of Gaussian components per pixel
-      BwImage m_modes_per_pixel;
-
-      // Current background model
-      RgbImage m_background;
-
-      // Factor control for the T2FGMM-UM
-      float km;
-      // Factor control for the T2FGMM-UV
-      float kv;
-    };
+      const int TYPE_T2FMRF_UM = 0;
+      const int TYPE_T2FMRF_UV = 1;
+
+      enum HiddenState {background, foreground};
+
+      typedef struct HMMState 
+      {
+        float T;
+        //Hidden State
+        HiddenState State;
+        //transition probability
+        float Ab2b;
+        float Ab2f;
+        float Af2f;
+        float Af2b;
+      } HMM;
+
+      // Transition probabilities of the hidden state. T2FMRF::InitModel() gives
+      // every pixel the same values and nothing learns them afterwards (the
+      // per pixel updates only write the state), so a single table shared by
+      // all pixels holds what the per pixel copies did. Learning transitions
+      // per pixel would need them stored per pixel again.
+      typedef struct HMMTransitionTable
+      {
+        float T;
+        float Ab2b;
+        float Ab2f;
+        float Af2f;
+        float Af2b;
+      } HMMTransitions;
+
+      // Hidden state of every pixel packed one bit per pixel, with the shared
+      // transition table. Replaces one HMM struct (24 bytes) per pixel.
+      class PackedHMM
+      {
+      public:
+        PackedHMM() : m_size(0) {}
+
+        void Resize(long pixels)
+        {
+          m_size = pixels;
+          m_bits.assign((pixels + 63)/64, 0);
+        }
+
+        void Reset(HiddenState state)
+        {
+          std::fill(m_bits.begin(), m_bits.end(), state == foreground ? ~0ULL : 0ULL);
+        }
+
+        inline HiddenState State(long pixel) const
+        {
+          return (HiddenState)((m_bits[pixel >> 6] >> (pixel & 63)) & 1);
+        }
+
+        inline void SetState(long pixel, HiddenState state)
+        {
+          unsigned long long bit = 1ULL << (pixel & 63);
+          unsigned long long &word = m_bits[pixel >> 6];
+          word = (state == foreground) ? (word | bit) : (word & ~bit);
+        }
+
+        HMMTransitions &Transitions() { return m_transitions; }
+        const HMMTransitions &Transitions() const { return m_transitions; }
+
+        long Size() const { return m_size; }
+
+      private:
+        long m_size;
+        std::vector<unsigned long long> m_bits;
+        HMMTransitions m_transitions;
+      };
+
+      //typedef struct GMMGaussian
+      //{
+      //  float variance;
+      //  float muR;
+      //  float muG;
+      //  float muB;
+      //  float weight;
+      //  float significants; // this is equal to weight / standard deviation and is used to
+      //  // determine which Gaussians should be part of the background model
+      //} GMM;
+
+      // --- User adjustable parameters used by the T2F GMM BGS algorithm ---
+      class T2FMRFParams : public BgsParams
+      {
+      public:
+        T2FMRFParams() : m_threads(0) {}
+
+        float &LowThreshold() { return m_low_threshold; }
+        float &HighThreshold() { return m_high_threshold; }
+
+        float &Alpha() { return m_alpha; }
+        int &MaxModes() { return m_max_modes; }
+        int &Type() { return m_type; }
+        float &KM() { return m_km; }
+        float &KV() { return m_kv; }
+
+        int &Threads() { return m_threads; }
+
+      private:
+        // Threshold on the squared dist. to decide when a sample is close to an existing 
+        // components. If it is not close to any a new component will be generated. 
+        // Smaller threshold values lead to more generated components and higher threshold values 
+        // lead to a small number of components but they can grow too large.
+        //
+        // It is usual easiest to think of these thresholds as being the number of variances away
+        // from the mean of a pixel before it is considered to be from the foreground.
+        float m_low_threshold;
+        float m_high_threshold;
+
+        // alpha - speed of update - if the time interval you want to average over is T
+        // set alpha=1/T. 
+        float m_alpha;
+
+        // Maximum number of modes (Gaussian components) that will be used per pixel
+        int m_max_modes;
+
+        // T2FMRF_UM / T2FMRF_UV
+        int m_type;
+
+        // Factor control for the T2FMRF-UM
+        float m_km;
+
+        // Factor control for the T2FMRF-UV
+        float m_kv;
+
+        // Threads of the per row loops, 0 uses all cores
+        int m_threads;
+      };
+
+      // --- T2FGMM BGS algorithm ---
+      class T2FMRF : public Bgs
+      {
+      public:
+        T2FMRF();
+        ~T2FMRF();
+
+        void Initalize(const BgsParams& param);
+        void InitModel(const RgbImage& data);
+        void Subtract(int frame_num, const RgbImage& data, BwImage& low_threshold_mask, BwImage& high_threshold_mask);	
+        void Update(int frame_num, const RgbImage& data, const BwImage& update_mask);
+
+        // Background image from the dominant mode of each pixel. It is computed
+        // on demand and cached until the model learns again.
+        RgbImage* Background();
+
+        GMM *gmm(void);
+        const PackedHMM &hmm(void) const;
+        // Gaussians in use at pixel (r,c), its modes start at gmm()+(r*Width+c)*MaxModes
+        unsigned char modesPerPixel(int r, int c);
+
+        // Learning on: Subtract() classifies and updates the model with the given alpha.
+        // Learning off: Subtract() only classifies against the current model.
+        void SetLearning(bool learning, float alpha);
+
+      private:	
+        void BackgroundRows(unsigned int first, unsigned int last);
+        float Distance(long pos, const RgbPixel& pixel);
+        void SubtractPixel(long posPixel, long posGMode, const RgbPixel& pixel, unsigned char& numModes, unsigned char& lowThreshold, unsigned char& highThreshold);
+        void ClassifyPixel(long posPixel, long posGMode, const RgbPixel& pixel, unsigned char numModes, unsigned char& lowThreshold, unsigned char& highThreshold);
+
+        // User adjustable parameters
+        T2FMRFParams m_params;
+
+        // Threshold when the component becomes significant enough to be included into
+        // the background model. It is the TB = 1-cf from the paper. So I use cf=0.1 => TB=0.9
+        // For alpha=0.001 it means that the mode should exist for approximately 105 frames before
+        // it is considered foreground
+        float m_bg_threshold; //1-cf from the paper
+
+        // Initial variance for the newly generated components. 
+        // It will will influence the speed of adaptation. A good guess should be made. 
+        // A simple way is to estimate the typical standard deviation from the images.
+        float m_variance;
+
+        // Dynamic array for the mixture of Gaussians
+        GMM* m_modes;
+
+        // Hidden state of each pixel and the scene transition table
+        PackedHMM m_state;
+
+        // Number of Gaussian components per pixel
+        BwImage m_modes_per_pixel;
+
+        // Current background model, valid while m_background_valid is set
+        RgbImage m_background;
+        bool m_background_valid;
+
+        // Factor control for the T2FGMM-UM
+        float km;
+        // Factor control for the T2FGMM-UV
+        float kv;
+
+        // Subtract() updates the model
+        bool m_learning;
+      };
+    }
   }
 }
 
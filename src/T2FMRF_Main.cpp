@@ -30,6 +30,10 @@
 #include "DisplayImageUtils.h"
 
 #include "utils.h"
+#include "MaskArchive.h"
+#include "PrefetchFrameReader.h"
+#include "DriverOutput.h"
+#include "StageTimer.h"
 
 using namespace cv;
 using namespace std;
@@ -44,8 +48,15 @@ const char* keys =
     "{ f | input     |       | Input video }"
     "{ m | mask      | true  | Save foreground masks}"
     "{ s | show      | true  | Show display window}"
-    "{ p | point     |       | Pin a red dot on the images for debugging,  e.g -p 250,300 }"
+    "{ p | point     |       | Pin red dots and trace pixels and model state to <alg>_points.trace, e.g -p 250,300;10,20 or a file of points }"
     "{ r | range     |       | Select a valid range save foreground masks}"
+    "{ o | output    | png   | Mask output: png files, or bits, rle or delta encoded archive <alg>_mask/masks.bgsm }"
+    "{ j | prefetch  | 8     | Frames decoded ahead on helper threads for image directories, 0 disables, off when the files do not match the FrameReader frame count }"
+    "{ t | stream    |       | Stream masks to a named pipe, or stdout }"
+    "{ e | encoding  | raw   | Stream encoding: raw or rle }"
+    "{ k | seek      | false | Start at the range start minus the algorithm WarmupFrames, stop at the range end }"
+    "{ g | groundtruth |     | Directory of ground-truth images, scores the range in-process to <alg>_scores.txt }"
+    "{ x | trace     |       | Write a Chrome trace of the frames, tiles and stages to this file, open it in Perfetto }"
     "{ h | help      | false | Print help message }"
 };
 
@@ -78,6 +89,13 @@ int main( int argc, char** argv )
     const string pinPoint                 = cmd.get<string>("point");
     const bool saveForegroundMask         = cmd.get<bool>("mask");
     const string  rangeSaveForegroundMask = cmd.get<string>("range");
+    const string maskOutput               = cmd.get<string>("output");
+    const int prefetchFrames              = cmd.get<int>("prefetch");
+    const string maskStream               = cmd.get<string>("stream");
+    const string streamEncoding           = cmd.get<string>("encoding");
+    const bool seekRange                  = cmd.get<bool>("seek");
+    const string groundTruth              = cmd.get<string>("groundtruth");
+    const string traceFile                = cmd.get<string>("trace");
     
     // Show help not input options
     if (cmd.get<bool>("help")) {
@@ -85,6 +103,19 @@ int main( int argc, char** argv )
         cmd.printParams();
         return 0;
     }
+
+    // Masks go to png files or to an archive with one of the encodings
+    uint32_t encoding;
+    int keyframes;
+    const bool archiveOutput = mask_encoding_from_name(maskOutput, encoding, keyframes);
+    if (!archiveOutput && maskOutput != "png") {
+        cout << "Unknown mask output " << maskOutput << ", use png, bits, rle or delta" << endl;
+        return 0;
+    }
+
+    // Timeline of the frames, tiles and stages, written at exit
+    if (!traceFile.empty())
+        ChromeTrace::Enable(traceFile);
     
     // Verify input name is a video file or directory with image files.
     FrameReader *input_frame;
@@ -94,13 +125,22 @@ int main( int argc, char** argv )
         cout << "Invalid file name "<< endl;
         return 0;
     }
+
+    // Send masks to another process, messages go to stderr when the
+    // masks take stdout
+    DriverOutput output(algNameLowercase);
+    output.OpenStream(maskStream, streamEncoding);
+
+    // Decode image files ahead of the model
+    PrefetchFrameReader frames(input_frame, inputName, prefetchFrames);
    
     
     // Algorithm Instantiate
     BGSSystem* bgs = new BGSSystem();
-    bgs->setAlgorithm(new T2FMRF_UMBuilder(input_frame->getNumberCols(),
-                                           input_frame->getNumberRows(),
-                                           input_frame->getNChannels()   ));
+    T2FMRF_UMBuilder* builder = new T2FMRF_UMBuilder(input_frame->getNumberCols(),
+                                                     input_frame->getNumberRows(),
+                                                     input_frame->getNChannels()   );
+    bgs->setAlgorithm(builder);
     bgs->setName(ALGORITHM_NAME);
     bgs->loadConfigParameters();
     bgs->initializeAlgorithm();
@@ -108,43 +148,27 @@ int main( int argc, char** argv )
     int  InitFGMaskFrame=0;
     int  EndFGMaskFrame = input_frame->getNFrames();
 
-    // Prapare mask directory
-    string _foreground_path    = algNameLowercase + "_mask";
-    
-    // Create foreground directory and numbered sub-directories (alg_mask/0, alg_mask/1, ...)
-    if (saveForegroundMask) {
-
-        create_foreground_directory(_foreground_path);
-
-        std::ofstream outfile;
-        stringstream param;
-
-        param << _foreground_path << "/parameters.txt" ;
-        outfile.open(param.str().c_str());
-        outfile << bgs->getConfigurationParameters();
-        outfile.close();
-
-        if (!rangeSaveForegroundMask.empty()) {
-            Point pf;
-            pf = stringToPoint(rangeSaveForegroundMask);
-            InitFGMaskFrame = pf.x;
-            EndFGMaskFrame  = pf.y;
-        }
+    // The range also selects the frames scored against the ground truth
+    if (!rangeSaveForegroundMask.empty()) {
+        Point pf;
+        pf = stringToPoint(rangeSaveForegroundMask);
+        InitFGMaskFrame = pf.x;
+        EndFGMaskFrame  = pf.y;
     }
+    output.SetRange(InitFGMaskFrame, EndFGMaskFrame);
 
-    Point pin(0,0);
-    std::ofstream point_file;
-
-    // Define a point to be pinned on a display window
-    if ( !pinPoint.empty() ) {
+    // Create foreground directory and numbered sub-directories (alg_mask/0, alg_mask/1, ...)
+    if (saveForegroundMask)
+        output.OpenMasks(bgs->getConfigurationParameters(),
+                         Size(input_frame->getNumberCols(), input_frame->getNumberRows()),
+                         archiveOutput, encoding, keyframes);
 
-        pin = stringToPoint(pinPoint);
-        pin.x = pin.x > input_frame->getNumberCols() ? 
-                        input_frame->getNumberCols(): pin.x;
-        pin.y = pin.y > input_frame->getNumberRows() ? 
-                        input_frame->getNumberRows(): pin.y;
+    // Score the masks while they are computed instead of reading them back
+    output.OpenGroundTruth(groundTruth);
 
-    }
+    // Define the points to be pinned on a display window and traced
+    output.SetPins(pinPoint, Size(input_frame->getNumberCols(), input_frame->getNumberRows()));
+    const vector<Point>& pins = output.Pins();
 
     Mat CurrentFrame;
     Mat Foreground;
@@ -153,61 +177,64 @@ int main( int argc, char** argv )
     int delay = input_frame->getFrameDelay();
     int cnt = 0;
 
+    // Jump to the range, the model only sees its warm-up frames before it
+    if (seekRange && !rangeSaveForegroundMask.empty()) {
+        cnt = std::max(0, InitFGMaskFrame - builder->WarmupFrames());
+        if (!frames.Seek(cnt))
+            cout << "Range starts after the end of the sequence" << endl;
+    }
+
+    // Time of each step of a frame, reported at the end with the stages
+    // of the model
+    StageTimer timing("driver");
+    const int stageDecode  = timing.Stage("decode");
+    const int stageUpdate  = timing.Stage("update");
+    const int stageStream  = timing.Stage("stream");
+    const int stageScore   = timing.Stage("score");
+    const int stageWrite   = timing.Stage("write");
+    const int stageTrace   = timing.Stage("pixels");
+    const int stageDisplay = timing.Stage("display");
+
+    const int traceFrame   = ChromeTrace::Name("frame");
+    const int traceDriver  = ChromeTrace::Name("driver");
+
     // main loop
     for(;;)
     {
+        StageTimer::Clock::time_point t = StageTimer::Clock::now();
+        StageTimer::Clock::time_point frameBegin = t;
 
         Foreground = Scalar::all(0);
 
-        input_frame->getFrame(CurrentFrame);
+        frames.getFrame(CurrentFrame);
         
         if (CurrentFrame.empty()) break;
+        t = timing.Mark(stageDecode, t);
     
         bgs->updateAlgorithm(CurrentFrame, Foreground);
+        t = timing.Mark(stageUpdate, t);
+
+        output.StreamMask(cnt, Foreground);
+        t = timing.Mark(stageStream, t);
+
+        output.ScoreMask(cnt, Foreground);
+        t = timing.Mark(stageScore, t);
         
         // Save foreground images
-        if (saveForegroundMask && cnt >= InitFGMaskFrame && cnt <= EndFGMaskFrame) {
-            stringstream str;
-            vector<int> compression_params;
-            compression_params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-            compression_params.push_back(9);
-
-            try {
-                str << _foreground_path << "/" <<  cnt << ".png";
-                imwrite(str.str(), Foreground, compression_params);
-            }
-            catch (runtime_error& ex) {
-                cout << "Exception converting image to PNG format: " << ex.what() << endl;
-            }
-            catch (...) {
-                cout << "Unknown Exception converting image to PNG format: " << endl;
-            }
-        }
+        output.WriteMask(cnt, Foreground);
+        t = timing.Mark(stageWrite, t);
         
-        // Save pixel information in a local file
-        if (!pinPoint.empty()) {
-
-            stringstream msgPoint;
-            msgPoint  << (int)CurrentFrame.at<Vec3b>(pin)[0] << " "
-                      << (int)CurrentFrame.at<Vec3b>(pin)[1] << " "
-                      << (int)CurrentFrame.at<Vec3b>(pin)[2] ;
-
-            //define outfile to save BGR pixel values
-            if (!point_file.is_open()){
-                stringstream name("");
-                name << "point_" << pin.x << "_" << pin.y << ".txt";
-                point_file.open(name.str().c_str());
-            }
+        // Trace pixels and model state
+        output.TracePixels(cnt, CurrentFrame, Foreground, *builder);
 
-            point_file<< msgPoint.str() << endl;
-        }
+        t = timing.Mark(stageTrace, t);
 
         if (showWindow) {
 
-            // Insert pin on the Window.
-            if (!pinPoint.empty()){
-                circle(CurrentFrame,pin,8,Scalar(0,0,254),-1,8);
-                circle(Foreground  ,pin,8,Scalar(0,0,254),-1,8);
+            // Insert pins on the Window.
+            for (size_t k = 0; k < pins.size(); ++k) {
+                circle(CurrentFrame,pins[k],8,Scalar(0,0,254),-1,8);
+                circle(Foreground  ,pins[k],8,Scalar(0,0,254),-1,8);
             }
 
             // Invert color of Mask from black to white
@@ -247,18 +274,34 @@ int main( int argc, char** argv )
                 }
             }
         }
+        t = timing.Mark(stageDisplay, t);
+        ChromeTrace::Span(traceFrame, traceDriver, frameBegin, t, cnt);
 
 
         cnt +=1;
 
-        if (!showWindow && cnt > EndFGMaskFrame) break;
+        if ((!showWindow || seekRange) && cnt > EndFGMaskFrame) break;
         
     }
     
+    // Report frames where the MRF stopped on its time/iteration budget
+    if (builder->BudgetHits() > 0)
+        cout << "MRF budget hit in " << builder->BudgetHits() << " of "
+             << builder->MRFFrames() << " frames" << endl;
     
+    // Where the time of a frame went, driver steps then model stages
+    cout << timing.Report(ALGORITHM_NAME + " driver");
+    cout << builder->Timing().Report(ALGORITHM_NAME + " model");
+
+    // Scores with the parameters that produced them
+    output.Summary(bgs->getConfigurationParameters());
+
+    if (ChromeTrace::Enabled() && !ChromeTrace::Write())
+        cout << "Could not write trace " << traceFile << endl;
+
     delete bgs;
     delete input_frame;
-    if (point_file.is_open()) point_file.close();
+    output.Close();
 
     return 0;
 }
@@ -14,6 +14,8 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
+#include <cmath>
+#include <algorithm>
 #include "T2FMRF_UMBuilder.h"
 
 
@@ -24,6 +26,11 @@ const double       T2FMRF_UMBuilder::DefaultAlpha       = 0.001;
 const float        T2FMRF_UMBuilder::DefaultKm          = 1.5f;
 const float        T2FMRF_UMBuilder::DefaultKv          = 0.6f; 
 const int          T2FMRF_UMBuilder::DefaultGaussians   = 3;
+const int          T2FMRF_UMBuilder::DefaultModelUpdateInterval = 1;
+const int          T2FMRF_UMBuilder::DefaultMRFSolver   = MRF_SOLVER_ICM;
+const double       T2FMRF_UMBuilder::DefaultMRFDeadline = 0.;
+const int          T2FMRF_UMBuilder::DefaultMRFMaxIterations = 0;
+const int          T2FMRF_UMBuilder::DefaultWarmupFrames = 200;
 
 
 T2FMRF_UMBuilder::T2FMRF_UMBuilder()
@@ -34,6 +41,10 @@ T2FMRF_UMBuilder::T2FMRF_UMBuilder()
     nchannels = 0;
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
+    mrf_frames = 0;
+    budget_hits = 0;
     model_frame.ReleaseMemory(false);
 
 }
@@ -46,6 +57,10 @@ T2FMRF_UMBuilder::T2FMRF_UMBuilder(int _col, int _row, int _nchannels)
     nchannels = _nchannels;
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
+    mrf_frames = 0;
+    budget_hits = 0;
     model_frame.ReleaseMemory(false);
 
 }
@@ -60,6 +75,10 @@ T2FMRF_UMBuilder::T2FMRF_UMBuilder(Size _size, int _type)
     nchannels = CV_MAT_CN(frameType);
     has_been_initialized = false;
     frame_counter = 0;
+    threads = 0;
+    setupTiming();
+    mrf_frames = 0;
+    budget_hits = 0;
     model_frame.ReleaseMemory(false);
 }
 
@@ -85,11 +104,16 @@ void T2FMRF_UMBuilder::Initialization()
         modelParams.SetFrameSize(cols, rows);
         modelParams.LowThreshold()  = threshold;
         modelParams.HighThreshold() = 2*modelParams.LowThreshold();
-        modelParams.Alpha()         = alpha;
+        // The model is updated every modelUpdateInterval frames, compensate
+        // alpha so the adaptation time (in frames) stays the same.
+        updateAlpha = 1. - std::pow(1. - alpha, modelUpdateInterval);
+
+        modelParams.Alpha()         = updateAlpha;
         modelParams.MaxModes()      = gaussians;
         modelParams.Type()          = TYPE_T2FMRF_UM;
         modelParams.KM()            = km; // Factor control for the T2FMRF-UM [0,3] default: 1.5
         modelParams.KV()            = kv; // Factor control for the T2FMRF-UV [0.3,1] default: 0.6
+        modelParams.Threads()       = threads;
 
 
         model = new T2FMRF();
@@ -99,12 +123,16 @@ void T2FMRF_UMBuilder::Initialization()
         model->InitModel(dummy);
 
 
-        previous_frame = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
-        previous_saved = cvCreateImage(cvSize(cols, rows), IPL_DEPTH_8U, 1);
-
-        mrf.height = rows;
-        mrf.width  = cols;
+        // The MRF keeps the label history itself, in_image is read every
+        // frame and the result is written back in place.
+        mrf.height    = rows;
+        mrf.width     = cols;
+        mrf.num_modes = gaussians;
+        mrf.in_image  = lowThresholdMask.Ptr();
+        mrf.out_image = lowThresholdMask.Ptr();
         mrf.Build_Classes_OldLabeling_InImage_LocalEnergy();
+        mrf.SetBudget(mrfDeadline, mrfMaxIterations);
+        mrf.SetThreads(threads);
 
         has_been_initialized = true;
     }
@@ -114,11 +142,9 @@ void T2FMRF_UMBuilder::Initialization()
 
 void T2FMRF_UMBuilder::GetBackground(OutputArray image) 
 {
-    /*
-    Mat img_background;
-    model->getBackgroundImage(img_background);
+    // computed by the model only when requested
+    Mat img_background(model->Background()->Ptr());
     img_background.copyTo(image);
-    */
 }
 
 void T2FMRF_UMBuilder::GetForeground(OutputArray mask) 
@@ -128,42 +154,50 @@ void T2FMRF_UMBuilder::GetForeground(OutputArray mask)
 
 void T2FMRF_UMBuilder::Update(InputArray frame, OutputArray mask) 
 {
+    StageTimer::Clock::time_point t = StageTimer::Clock::now();
+    StageTimer::Clock::time_point begin = t;
 
     Mat Image = frame.getMat();
     //Mat Foreground(Image.size(),CV_8U,Scalar::all(0));
 
-    input_frame = new IplImage(Image);
-    model_frame = input_frame;
+    // only the header is rebuilt, the pixels stay in the caller's Mat
+    input_header = Image;
+    model_frame  = &input_header;
 
 
+    // Subtract every frame, learn only every modelUpdateInterval frames
+    model->SetLearning(frame_counter % modelUpdateInterval == 0, updateAlpha);
     model->Subtract(frame_counter , model_frame, lowThresholdMask, highThresholdMask);
-
-    cvCopy(lowThresholdMask.Ptr(), previous_frame);
+    t = timing.Mark(stageSubtract, t);
 
     if(frame_counter >=10) 
     {
         gmm = model->gmm();
-        hmm = model->hmm();
         mrf.background2 = model_frame.Ptr();
-        mrf.in_image    = lowThresholdMask.Ptr();
-        mrf.out_image   = lowThresholdMask.Ptr();
-        mrf.InitEvidence2(gmm,hmm,previous_saved);
-        mrf.ICM2();
-        cvCopy(mrf.out_image, lowThresholdMask.Ptr());
-    }
+        mrf.InitEvidence2(gmm,model->hmm());
+        mrf.Solve(mrfSolver);
 
-    cvCopy(previous_frame, previous_saved);
+        mrf_frames += 1;
+        if (mrf.BudgetHit())
+            budget_hits += 1;
+    }
+    else
+        mrf.PushLabels();
+    t = timing.Mark(stageMrf, t);
 
     lowThresholdMask.Clear();
     model->Update(frame_counter, model_frame, lowThresholdMask);
+    timing.Mark(stageUpdate, t);
 
     Mat Foreground(highThresholdMask.Ptr());
 
     Foreground.copyTo(mask);
-    delete input_frame;
 
     frame_counter += 1;
 
+    timing.Mark(stageFrame, begin);
+    duration = timing.Last(stageFrame);
+
 
 
 
@@ -199,6 +233,11 @@ void T2FMRF_UMBuilder::loadDefaultParameters()
     km          = DefaultKm         ;
     kv          = DefaultKv         ; 
     gaussians   = DefaultGaussians  ;
+    modelUpdateInterval = DefaultModelUpdateInterval;
+    mrfSolver   = DefaultMRFSolver  ;
+    mrfDeadline = DefaultMRFDeadline;
+    mrfMaxIterations = DefaultMRFMaxIterations;
+    warmupFrames     = DefaultWarmupFrames;
 }
 
 string T2FMRF_UMBuilder::PrintParameters()
@@ -211,7 +250,12 @@ string T2FMRF_UMBuilder::PrintParameters()
     << "Alpha="        << alpha       << " "
     << "Km="           << km          << " "
     << "Kv="           << kv          << " " 
-    << "Gaussians="    << gaussians   ;
+    << "Gaussians="    << gaussians   << " "
+    << "ModelUpdateInterval=" << modelUpdateInterval << " "
+    << "MRFSolver="    << mrfSolver   << " "
+    << "MRFDeadline="  << mrfDeadline << " "
+    << "MRFMaxIterations=" << mrfMaxIterations << " "
+    << "WarmupFrames=" << warmupFrames;
     return str.str();
 
 }
@@ -228,16 +272,7 @@ void T2FMRF_UMBuilder::LoadConfigParameters()
 
     if ( exists(filename) && is_regular_file(filename) ) {
         
-        FileStorage fs(filename, FileStorage::READ);
-
-        frameNumber = (int)fs["FrameNumber"];
-        threshold   = (double)fs["Threshold"];
-        alpha       = (double)fs["Alpha"];
-        km          = (float)fs["Km"];
-        kv          = (float)fs["Kv"];
-        gaussians   = (int)fs["Gaussians"];
-
-        fs.release();
+        LoadConfigParameters(filename);
     }
     else {
         path p("config");
@@ -252,6 +287,11 @@ void T2FMRF_UMBuilder::LoadConfigParameters()
         fs << "Km"          << km         ; 
         fs << "Kv"          << kv         ; 
         fs << "Gaussians"   << (int)gaussians  ; 
+        fs << "ModelUpdateInterval" << modelUpdateInterval; 
+        fs << "MRFSolver"   << mrfSolver  ; 
+        fs << "MRFDeadline" << mrfDeadline; 
+        fs << "MRFMaxIterations" << mrfMaxIterations; 
+        fs << "WarmupFrames" << warmupFrames; 
 
         fs.release();
 
@@ -259,6 +299,42 @@ void T2FMRF_UMBuilder::LoadConfigParameters()
 
 }
 
+void T2FMRF_UMBuilder::LoadConfigParameters(const string& filename)
+{
+    FileStorage fs(filename, FileStorage::READ);
+
+    frameNumber = (int)fs["FrameNumber"];
+    threshold   = (double)fs["Threshold"];
+    alpha       = (double)fs["Alpha"];
+    km          = (float)fs["Km"];
+    kv          = (float)fs["Kv"];
+    gaussians   = (int)fs["Gaussians"];
+
+    // Optional entries, older config files do not have them
+    if (!fs["ModelUpdateInterval"].empty())
+        modelUpdateInterval = std::max(1, (int)fs["ModelUpdateInterval"]);
+    if (!fs["MRFSolver"].empty())
+        mrfSolver = (int)fs["MRFSolver"];
+    if (!fs["MRFDeadline"].empty())
+        mrfDeadline = (double)fs["MRFDeadline"];
+    if (!fs["MRFMaxIterations"].empty())
+        mrfMaxIterations = (int)fs["MRFMaxIterations"];
+    if (!fs["WarmupFrames"].empty())
+        warmupFrames = std::max(0, (int)fs["WarmupFrames"]);
+
+    fs.release();
+}
+
+
+void T2FMRF_UMBuilder::setupTiming()
+{
+    duration      = 0.;
+    timing        = StageTimer("model");
+    stageSubtract = timing.Stage("subtract");
+    stageMrf      = timing.Stage("mrf");
+    stageUpdate   = timing.Stage("update");
+    stageFrame    = timing.Stage("frame");
+}
 
 string T2FMRF_UMBuilder::ElapsedTimeAsString()
 {
@@ -268,4 +344,35 @@ string T2FMRF_UMBuilder::ElapsedTimeAsString()
 }
 
 
+int T2FMRF_UMBuilder::PixelStateSize()
+{
+    return 1 + 5*gaussians + 1;
+}
 
+string T2FMRF_UMBuilder::PixelStateLayout()
+{
+    std::stringstream str;
+    str << "modes,{weight,variance,muR,muG,muB}x" << gaussians << ",hmm";
+    return str.str();
+}
+
+void T2FMRF_UMBuilder::PixelState(Point p, float* state)
+{
+    std::fill(state, state + PixelStateSize(), 0.f);
+    if (!has_been_initialized)
+        return;
+
+    // unused modes are left at zero
+    const GMM* modes = model->gmm() + (p.y*cols + p.x)*gaussians;
+    int n = model->modesPerPixel(p.y, p.x);
+    state[0] = n;
+    for (int k = 0; k < n; ++k) {
+        float* s = state + 1 + 5*k;
+        s[0] = modes[k].weight;
+        s[1] = modes[k].variance;
+        s[2] = modes[k].muR;
+        s[3] = modes[k].muG;
+        s[4] = modes[k].muB;
+    }
+    state[1 + 5*gaussians] = model->hmm().State(p.y*cols + p.x);
+}
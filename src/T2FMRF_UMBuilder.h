@@ -15,18 +15,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ******************************************************************************/
 
-#ifndef _IMBS_ALGORITHM_H
-#define _IMBS_ALGORITHM_H
+#ifndef _T2FMRF_UM_BUILDER_H
+#define _T2FMRF_UM_BUILDER_H
 
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include "IBGSAlgorithm.h"
+#include "StageTimer.h"
 #include "T2FMRF.h"
 #include "MRF.h"
 
 using namespace cv;
 using namespace boost::filesystem;
 using namespace Algorithms::BackgroundSubtraction;
+using namespace Algorithms::BackgroundSubtraction::BgsClient;
 
 
 class T2FMRF_UMBuilder: public IBGSAlgorithm
@@ -42,6 +44,8 @@ public:
     ~T2FMRF_UMBuilder();
     void SetAlgorithmParameters()  {};
     void LoadConfigParameters();
+    // Parameters of another config file, e.g. one configuration of a sweep
+    void LoadConfigParameters(const string& filename);
     void SaveConfigParameters() {};
     void Initialization();
     void GetBackground(OutputArray);
@@ -51,11 +55,36 @@ public:
     void SaveModel() {};
     string PrintParameters();
     const string Name() {return AlgorithmName; };
+    // Milliseconds of the last Update(), Timing() has each of its stages
     string ElapsedTimeAsString();
     double ElapsedTime(){ return duration; };
+    const StageTimer& Timing() const { return timing; };
+
+    // Frames the model needs before its masks are worth evaluating, the
+    // drivers start that many frames before the --range start with --seek
+    int WarmupFrames() const { return warmupFrames; };
+
+    // ModelUpdateInterval without a config file, call before Initialization()
+    void SetModelUpdateInterval(int k) { modelUpdateInterval = std::max(1, k); };
+
+    // Threads of the model's per row loops, 0 (the default) uses all
+    // cores. Call before Initialization().
+    void SetThreads(int n) { threads = std::max(0, n); };
+
+    // Model state of a pixel for the pixel trace (PixelTrace.h), call
+    // after the first Update(). PixelStateLayout() names the values.
+    int    PixelStateSize();
+    string PixelStateLayout();
+    void   PixelState(Point p, float* state);
+
+    // Frames the MRF ran on, and how many of them stopped on the
+    // MRFDeadline/MRFMaxIterations budget
+    int MRFFrames() const { return mrf_frames; };
+    int BudgetHits() const { return budget_hits; };
 
 private:
     void loadDefaultParameters();
+    void setupTiming();
 
     int rows;
     int cols;
@@ -65,6 +94,8 @@ private:
     Size frameSize;
     int  frameType;
     double duration;
+    StageTimer timing;
+    int  stageSubtract, stageMrf, stageUpdate, stageFrame;
 
     //unsigned char *FilterFGImage;
     static const string AlgorithmName;
@@ -75,17 +106,14 @@ private:
      */
     MRF_TC mrf;
     GMM *gmm;
-    HMM *hmm;
     T2FMRFParams modelParams;
     T2FMRF* model;
 
     BwImage lowThresholdMask;
     BwImage highThresholdMask;
 
-    IplImage* input_frame;
+    IplImage  input_header;
     RgbImage  model_frame;
-    IplImage* previous_frame;
-    IplImage* previous_saved;
 
     long         frameNumber;
     double       threshold;
@@ -93,6 +121,17 @@ private:
     float        km;
     float        kv;
     int          gaussians;
+    int          modelUpdateInterval;
+    int          threads;
+    double       updateAlpha;
+    // one of the MRF_SOLVER_* constants of MRF.h
+    int          mrfSolver;
+    // per frame MRF budget in milliseconds and sweeps, 0 is no limit
+    double       mrfDeadline;
+    int          mrfMaxIterations;
+    int          warmupFrames;
+    int          mrf_frames;
+    int          budget_hits;
 
     static const long         DefaultFrameNumber;
     static const double       DefaultThreshold;
@@ -100,6 +139,11 @@ private:
     static const float        DefaultKm;
     static const float        DefaultKv;
     static const int          DefaultGaussians;
+    static const int          DefaultModelUpdateInterval;
+    static const int          DefaultMRFSolver;
+    static const double       DefaultMRFDeadline;
+    static const int          DefaultMRFMaxIterations;
+    static const int          DefaultWarmupFrames;
 
 };
 
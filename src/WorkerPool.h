@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * This file is part of libraries to evaluate performance of Background
+ * Subtraction algorithms.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ******************************************************************************/
+
+#ifndef _WORKER_POOL_H
+#define _WORKER_POOL_H
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+
+/*
+ * Threads kept alive between calls, for work that is handed out every
+ * frame. run(n, body) calls body(i) once for each i in [0, n), on the
+ * workers and the calling thread, and returns when all calls are done.
+ * Tasks are taken one at a time, so tasks of uneven cost balance out.
+ */
+class WorkerPool
+{
+
+public:
+
+    // threads <= 0 uses all hardware threads, the caller counts as one
+    explicit WorkerPool(int threads = 0)
+        : tasks(0), next(0), done(0), generation(0), stop(false)
+    {
+        if (threads <= 0)
+            threads = std::thread::hardware_concurrency();
+        for (int t = 1; t < threads; ++t)
+            workers.push_back(std::thread(&WorkerPool::Work, this));
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        work_ready.notify_all();
+
+        for (size_t t = 0; t < workers.size(); ++t)
+            workers[t].join();
+    }
+
+    int Threads() const { return workers.size() + 1; };
+
+    void run(int n, std::function<void(int)> _body)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        body  = _body;
+        tasks = n;
+        next  = 0;
+        done  = 0;
+        ++generation;
+        work_ready.notify_all();
+
+        Take(lock);
+        work_done.wait(lock, [this] { return done == tasks; });
+        body = std::function<void(int)>();
+    }
+
+private:
+
+    // run tasks until none are left, called with the lock held
+    void Take(std::unique_lock<std::mutex>& lock)
+    {
+        while (next < tasks) {
+            int i = next++;
+            lock.unlock();
+            body(i);
+            lock.lock();
+            if (++done == tasks)
+                work_done.notify_all();
+        }
+    }
+
+    void Work()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        unsigned long seen = 0;
+
+        for (;;) {
+            work_ready.wait(lock, [&] { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+            Take(lock);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::function<void(int)> body;
+    int tasks;
+    int next;
+    int done;
+    unsigned long generation;
+    bool stop;
+
+    std::mutex mtx;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+
+};
+
+
+#endif
@@ -173,6 +173,10 @@ public:
     return fgThreshold;
   }
   void getBgModel(BgModel bgModel_copy[], int size);
+  //model of a single pixel without copying the whole frame
+  const BgModel* getPixelModel(unsigned int pixel) const {
+    return &bgModel[pixel];
+  }
 };
 
 #endif //__IMBS_HPP__
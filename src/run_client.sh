@@ -26,6 +26,15 @@ CAMERAS="Camera_3 Camera_4"
 run_algorithm="True"
 run_performance="True"
 
+# Score imbs, t2fgmm_um and t2fmrf_um against the ground truth while they
+# run (-g), without writing masks or running pmbgs afterwards
+in_process_scoring="False"
+
+# Mask output of imbs, t2fgmm_um and t2fmrf_um: 'png' files scored by
+# pmbgs, or a single masks.bgsm archive ('bits', 'rle', 'delta') that
+# bgs_masks scores in place into scores_<dir>.txt
+mask_output="png"
+
 # Binary command for performance
 pmbgs="pmbgs"
 pm_args=""
@@ -357,12 +366,24 @@ do
                 args="-i $sequence ${ext_args}"
                 range_args=$(eval "echo \$$(echo GT_${name})| sed 's/ /,/g'")
 
+                # set ground truth directory
+                camera=`echo ${cam} | sed s/_//`
+                ground_truth="${GT_PATH}/${action}${actor}${camera}"
+
+                scoring="False"
                 if [ "$ALGORITHM_NAME" == "imbs" ]; then
-                    args="-f ${sequence} ${ext_args} -r ${range_args}"
+                    args="-f ${sequence} ${ext_args} -r ${range_args} -o ${mask_output}"
+                    scoring=${in_process_scoring}
                 elif [ "$ALGORITHM_NAME" == "t2fgmm_um" ]; then
-                    args="-f ${sequence} ${ext_args} -r ${range_args}"
+                    args="-f ${sequence} ${ext_args} -r ${range_args} -o ${mask_output}"
+                    scoring=${in_process_scoring}
                 elif [ "$ALGORITHM_NAME" == "t2fmrf_um" ]; then
-                    args="-f ${sequence} ${ext_args} -r ${range_args}"
+                    args="-f ${sequence} ${ext_args} -r ${range_args} -o ${mask_output}"
+                    scoring=${in_process_scoring}
+                fi
+
+                if [ "$scoring" == "True" ]; then
+                    args="${args} -m false -g ${ground_truth}"
                 fi
 
                 hidden_name='.running_'${algorithm}'_'${name}
@@ -399,6 +420,10 @@ do
 
                             $cmd $args
                             #sleep 0.1
+
+                            if [ "$scoring" == "True" ]; then
+                                mv -f ${ALGORITHM_NAME}_scores.txt ${measure_dir}/scores_${_tag_1}_${in1}_${_tag_2}_${in2}.txt
+                            fi
                         done
 
                         # Verify this started from previous execution for recovering _list_2.
@@ -415,7 +440,7 @@ do
     
                 fi
 
-                if [ "$run_performance" == "True" ]; then
+                if [ "$run_performance" == "True" ] && [ "$scoring" != "True" ]; then
 
                     # Performance measure
                     # MASK_PATH  --> {.../results/masks}
@@ -423,10 +448,6 @@ do
                     # mask_name  --> {sagmm_Tubruk_L_0.001-0.005_T_2-100}
                     if [ -d "${MASK_PATH}/${name}" ]; then
 
-                        # set ground truth directory
-                        camera=`echo ${cam} | sed s/_//`
-                        ground_truth="${GT_PATH}/${action}${actor}${camera}"
-
                         mask="${MASK_PATH}/${name}/${mask_name}"
                         list_mask=$(ls -1rt ${mask} | tr '\n' ' ')
 
@@ -451,9 +472,13 @@ do
                             touch ${hidden_performance_name}
 
                             input="${mask}/${i}"
-                            args="-i ${input} -g ${ground_truth} ${_args}"
-                            $pmbgs $args
-                            mv -f output_*.txt ${measure_dir}
+                            if [ -e "${input}/masks.bgsm" ]; then
+                                bgs_masks -i ${input} -g ${ground_truth} -s ${measure_dir}/scores_${i}.txt
+                            else
+                                args="-i ${input} -g ${ground_truth} ${_args}"
+                                $pmbgs $args
+                                mv -f output_*.txt ${measure_dir}
+                            fi
                             rm ${hidden_performance_name}
                         done
 